@@ -456,21 +456,9 @@ int mbstrncasecmp(const char *s1, const char *s2, size_t n)
 /* This function is equivalent to strcasestr() for multibyte strings. */
 char *mbstrcasestr(const char *haystack, const char *needle)
 {
-#ifdef ENABLE_UTF8
-	if (using_utf8) {
-		size_t needle_len = mbstrlen(needle);
-
-		while (*haystack) {
-			if (mbstrncasecmp(haystack, needle, needle_len) == 0)
-				return (char *)haystack;
-
-			haystack += char_length(haystack);
-		}
+	prepare_for_caseless_search(needle);
 
-		return NULL;
-	} else
-#endif
-		return (char *)strcasestr(haystack, needle);
+	return (char *)find_caseless(haystack, strlen(haystack), haystack);
 }
 
 /* This function is equivalent to strstr(), except in that it scans the
@@ -493,54 +481,338 @@ char *revstrstr(const char *haystack, const char *needle,
 	return NULL;
 }
 
-/* This function is equivalent to strcasestr(), except in that it scans
- * the string in reverse, starting at pointer. */
-char *revstrcasestr(const char *haystack, const char *needle,
-		const char *pointer)
+/* The literal needle for which the tables below were made, and its length. */
+static char *literal = NULL;
+static size_t literal_len = 0;
+/* For each byte value: how far a window of the haystack can be moved when
+ * this byte is the last byte in the window (when searching forward) or the
+ * first byte in the window (when searching backward). */
+static size_t forward_shift[256], backward_shift[256];
+/* The index in the needle of its presumably least frequent byte. */
+static size_t rarest;
+
+/* Bytes that are common in text, roughly from most to least frequent. */
+#define COMMON_BYTES  " etaoinsrhldcumfpgwybv,.\t_ETAOINSRHLDCUMFPGWYBV()=;\"'-/*0123456789"
+
+/* Precompute what is needed to search quickly for the given literal needle:
+ * the skip tables for both directions, and the position of its rarest byte.
+ * When the tables were already made for this needle, do nothing. */
+void prepare_for_literal_search(const char *needle)
 {
-	size_t needle_len = strlen(needle);
-	size_t tail_len = strlen(pointer);
+	size_t lowest = HIGHEST_POSITIVE;
 
-	if (tail_len < needle_len)
-		pointer -= (needle_len - tail_len);
+	if (literal && strcmp(literal, needle) == 0)
+		return;
 
-	while (pointer >= haystack) {
-		if (strncasecmp(pointer, needle, needle_len) == 0)
-			return (char *)pointer;
-		pointer--;
+	free(literal);
+	literal = copy_of(needle);
+	literal_len = strlen(needle);
+
+	for (int byte = 0; byte < 256; byte++) {
+		forward_shift[byte] = literal_len;
+		backward_shift[byte] = literal_len;
+	}
+
+	for (size_t index = 0; index + 1 < literal_len; index++)
+		forward_shift[(unsigned char)needle[index]] = literal_len - 1 - index;
+
+	for (size_t index = literal_len; index > 1; index--)
+		backward_shift[(unsigned char)needle[index - 1]] = index - 1;
+
+	/* A byte that does not occur among the common ones is the best pick. */
+	rarest = 0;
+	for (size_t index = 0; index < literal_len; index++) {
+		const char *common = strchr(COMMON_BYTES, needle[index]);
+		size_t rank = (common ? sizeof(COMMON_BYTES) - (common - COMMON_BYTES) : 0);
+
+		if (rank < lowest) {
+			lowest = rank;
+			rarest = index;
+		}
 	}
+}
+
+/* Return the first occurrence of the prepared literal needle in the given
+ * haystack of the given length that starts at or after start, or NULL. */
+const char *find_literal(const char *haystack, size_t length, const char *start)
+{
+	const char *end = haystack + length;
+	const char *candidate, *spot;
+	size_t misses = 0;
+
+	if ((size_t)(end - start) < literal_len)
+		return NULL;
+	else if (literal_len == 0)
+		return start;
+
+	/* Let memchr() (which C libraries vectorize) find the places where the
+	 * rarest byte of the needle occurs, and check for a full match there. */
+	for (spot = start + rarest; spot < end - (literal_len - 1 - rarest); spot++) {
+		spot = memchr(spot, literal[rarest], end - (literal_len - 1 - rarest) - spot);
+
+		if (spot == NULL)
+			return NULL;
+
+		candidate = spot - rarest;
+		if (memcmp(candidate, literal, literal_len) == 0)
+			return candidate;
+
+		/* When the rare byte turns out to be frequent, switch to skipping. */
+		if (++misses > 16 && misses * 32 > (size_t)(spot - start)) {
+			start = candidate + 1;
+			break;
+		}
+	}
+
+	if (spot >= end - (literal_len - 1 - rarest))
+		return NULL;
+
+	/* Slide a window over the haystack, moving it as far as the last byte
+	 * in the window allows. */
+	for (candidate = start; candidate <= end - literal_len;
+				candidate += forward_shift[(unsigned char)candidate[literal_len - 1]])
+		if (candidate[literal_len - 1] == literal[literal_len - 1] &&
+								memcmp(candidate, literal, literal_len) == 0)
+			return candidate;
 
 	return NULL;
 }
 
-/* This function is equivalent to strcasestr() for multibyte strings,
- * except in that it scans the string in reverse, starting at pointer. */
-char *mbrevstrcasestr(const char *haystack, const char *needle,
-		const char *pointer)
+/* Return the last occurrence of the prepared literal needle in the given
+ * haystack of the given length that starts at or before start, or NULL. */
+const char *rfind_literal(const char *haystack, size_t length, const char *start)
 {
+	const char *candidate = start;
+
+	if (length < literal_len)
+		return NULL;
+	else if (candidate > haystack + length - literal_len)
+		candidate = haystack + length - literal_len;
+
+	/* Slide a window backward over the haystack, moving it as far as the
+	 * first byte in the window allows. */
+	while (TRUE) {
+		if (*candidate == *literal && memcmp(candidate, literal, literal_len) == 0)
+			return candidate;
+
+		if ((size_t)(candidate - haystack) < backward_shift[(unsigned char)*candidate])
+			return NULL;
+
+		candidate -= backward_shift[(unsigned char)*candidate];
+	}
+}
+
+/* The needle for which the caseless tables below were made. */
+static char *caseless = NULL;
+/* The case-folded forms of the characters in this needle, and their number. */
+static int *foldings = NULL;
+static size_t folding_count = 0;
+/* Which bytes can begin a character that folds to the first one of the needle;
+ * and, when there are only a few such bytes, which bytes these are. */
+static bool can_start[256];
+static unsigned char starters[4];
+static int starter_count;
+#ifdef ENABLE_UTF8
+/* The lowercase forms of the characters in the Basic Multilingual Plane. */
+static wchar_t *lowercase = NULL;
+#endif
+
+/* Store in value the case-folded form of the character at the given pointer,
+ * and return the length of this character.  An invalid byte gets a negative
+ * value, so that it matches only the same invalid byte. */
+int fold_char(const char *pointer, int *value)
+{
+	unsigned char byte = *pointer;
+
 #ifdef ENABLE_UTF8
 	if (using_utf8) {
-		size_t needle_len = mbstrlen(needle);
-		size_t tail_len = mbstrlen(pointer);
+		wchar_t wc;
+		int length;
 
-		if (tail_len < needle_len)
-			pointer -= (needle_len - tail_len);
+		if (byte < 0x80) {
+			*value = ('A' <= byte && byte <= 'Z') ? byte + 0x20 : byte;
+			return 1;
+		}
 
-		if (pointer < haystack)
-			return NULL;
+		length = mbtowide(&wc, pointer);
+
+		if (length < 0) {
+			*value = -1 - byte;
+			return 1;
+		}
+
+		*value = ((unsigned long)wc < 0x10000) ? (int)lowercase[wc] : (int)towlower(wc);
+		return length;
+	}
+#endif
+	*value = tolower(byte);
+	return 1;
+}
+
+/* Precompute what is needed to search quickly for the given needle without
+ * regard to case: the case-folded form of each of its characters, and the
+ * bytes that can begin a match.  When this was already done for the needle,
+ * do nothing. */
+void prepare_for_caseless_search(const char *needle)
+{
+	char single[2] = "";
+	int first, value;
+
+	if (caseless && strcmp(caseless, needle) == 0)
+		return;
+
+	free(caseless);
+	caseless = copy_of(needle);
+
+#ifdef ENABLE_UTF8
+	if (using_utf8 && lowercase == NULL) {
+		lowercase = nmalloc(0x10000 * sizeof(wchar_t));
+		for (unsigned int code = 0; code < 0x10000; code++)
+			lowercase[code] = towlower(code);
+	}
+#endif
+
+	foldings = nrealloc(foldings, (strlen(needle) + 1) * sizeof(int));
+	folding_count = 0;
+
+	while (*needle)
+		needle += fold_char(needle, &foldings[folding_count++]);
+
+	memset(can_start, FALSE, sizeof(can_start));
+	starter_count = 0;
+
+	if (folding_count == 0)
+		return;
+
+	first = foldings[0];
+
+	/* Note the single bytes that fold to the first character of the needle. */
+	for (int byte = 1; byte < 256; byte++) {
+		single[0] = byte;
+		if (fold_char(single, &value) == 1 && value == first)
+			can_start[byte] = TRUE;
+	}
+
+#ifdef ENABLE_UTF8
+	/* Note the leading bytes of the multibyte characters that fold to it. */
+	if (using_utf8 && first >= 0) {
+		for (unsigned int code = 0x80; code < 0x10000; code++)
+			if ((int)lowercase[code] == first)
+				can_start[(code < 0x800) ? 0xC0 | (code >> 6) : 0xE0 | (code >> 12)] = TRUE;
+
+		if (first >= 0x10000)
+			for (int byte = 0xF0; byte < 0xF5; byte++)
+				can_start[byte] = TRUE;
+	}
+#endif
+
+	for (int byte = 0; byte < 256; byte++)
+		if (can_start[byte] && starter_count++ < 4)
+			starters[starter_count - 1] = byte;
+}
+
+/* Return TRUE when the prepared caseless needle occurs at the given spot in
+ * the haystack that ends at end. */
+bool caseless_match_at(const char *haystack, const char *spot, const char *end)
+{
+#ifdef ENABLE_UTF8
+	/* A continuation byte that is part of a valid character is no start. */
+	if (using_utf8 && ((unsigned char)*spot & 0xC0) == 0x80) {
+		const char *lead = spot;
+
+		while (lead > haystack && spot - lead < 3 && ((unsigned char)lead[-1] & 0xC0) == 0x80)
+			lead--;
+
+		if (lead > haystack && (unsigned char)lead[-1] > 0xC1 &&
+								lead - 1 + char_length(lead - 1) > spot)
+			return FALSE;
+	}
+#endif
+	for (size_t index = 0; index < folding_count; index++) {
+		int value;
+
+		if (spot >= end)
+			return FALSE;
+
+		spot += fold_char(spot, &value);
+
+		if (value != foldings[index])
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Return the place of the given byte in the haystack at or after start,
+ * or end when it does not occur there. */
+const char *next_of(const char *start, const char *end, unsigned char byte)
+{
+	const char *spot = memchr(start, byte, end - start);
+
+	return (spot ? spot : end);
+}
+
+/* Return the first occurrence of the prepared caseless needle in the given
+ * haystack of the given length that starts at or after start, or NULL. */
+const char *find_caseless(const char *haystack, size_t length, const char *start)
+{
+	const char *end = haystack + length;
+	const char *next[4];
+
+	if (folding_count == 0)
+		return start;
+
+	/* When only a few bytes can begin a match, let memchr() (which C libraries
+	 * vectorize) find each of them, and try a match at the nearest one. */
+	if (starter_count <= 4) {
+		for (int index = 0; index < starter_count; index++)
+			next[index] = next_of(start, end, starters[index]);
 
 		while (TRUE) {
-			if (mbstrncasecmp(pointer, needle, needle_len) == 0)
-				return (char *)pointer;
+			const char *spot = end;
+
+			for (int index = 0; index < starter_count; index++)
+				if (next[index] < spot)
+					spot = next[index];
 
-			if (pointer == haystack)
+			if (spot == end)
 				return NULL;
 
-			pointer = haystack + step_left(haystack, pointer - haystack);
+			if (caseless_match_at(haystack, spot, end))
+				return spot;
+
+			for (int index = 0; index < starter_count; index++)
+				if (next[index] == spot)
+					next[index] = next_of(spot + 1, end, starters[index]);
 		}
-	} else
-#endif
-		return revstrcasestr(haystack, needle, pointer);
+	}
+
+	for (; start < end; start++)
+		if (can_start[(unsigned char)*start] && caseless_match_at(haystack, start, end))
+			return start;
+
+	return NULL;
+}
+
+/* Return the last occurrence of the prepared caseless needle in the given
+ * haystack of the given length that starts at or before start, or NULL. */
+const char *rfind_caseless(const char *haystack, size_t length, const char *start)
+{
+	const char *end = haystack + length;
+	const char *spot = (start < end) ? start : end;
+
+	if (folding_count == 0)
+		return spot;
+
+	while (TRUE) {
+		if (can_start[(unsigned char)*spot] && caseless_match_at(haystack, spot, end))
+			return spot;
+
+		if (spot == haystack)
+			return NULL;
+
+		spot--;
+	}
 }
 
 #if !defined(NANO_TINY) || defined(ENABLE_JUSTIFY)
@@ -23,11 +23,15 @@
 
 #ifdef ENABLE_COLOR
 
+#include <ctype.h>
 #include <errno.h>
 #ifdef HAVE_MAGIC_H
 #include <magic.h>
 #endif
+#include <stdint.h>
 #include <string.h>
+#define WIN32_LEAN_AND_MEAN 1
+#include <windows.h>
 
 static bool defaults_allowed = FALSE;
 		/* Whether ncurses accepts -1 to mean "default color". */
@@ -132,6 +136,603 @@ bool found_in_list(regexlisttype *head, const char *shibboleth)
 	return FALSE;
 }
 
+/* Make the given set hold just the empty string. */
+void set_to_empty(wordset *set)
+{
+	set->word[0] = copy_of("");
+	set->count = 1;
+}
+
+/* Free the strings in the given set. */
+void clear_words(wordset *set)
+{
+	while (set->count > 0)
+		free(set->word[--set->count]);
+}
+
+/* Make target a copy of source. */
+void copy_words(wordset *target, const wordset *source)
+{
+	clear_words(target);
+
+	for (int i = 0; i < source->count; i++)
+		target->word[i] = copy_of(source->word[i]);
+
+	target->count = source->count;
+}
+
+/* Add the strings of more to set, skipping duplicates.  Return FALSE
+ * (leaving set partially extended) when the result would be too big. */
+bool merge_words(wordset *set, const wordset *more)
+{
+	for (int i = 0; i < more->count; i++) {
+		int j = 0;
+
+		while (j < set->count && strcmp(set->word[j], more->word[i]) != 0)
+			j++;
+
+		if (j < set->count)
+			continue;
+		if (set->count == MAX_WORDS)
+			return FALSE;
+
+		set->word[set->count++] = copy_of(more->word[i]);
+	}
+
+	return TRUE;
+}
+
+/* Replace each string in run with its concatenations with the strings
+ * of tail.  Return FALSE (leaving run unchanged) when this is too big. */
+bool join_words(wordset *run, const wordset *tail)
+{
+	wordset result = {.count = 0};
+
+	if (run->count * tail->count > MAX_WORDS)
+		return FALSE;
+
+	for (int i = 0; i < run->count; i++)
+		for (int j = 0; j < tail->count; j++) {
+			size_t headlen = strlen(run->word[i]), taillen = strlen(tail->word[j]);
+
+			if (headlen + taillen > MAX_WORD_LEN) {
+				clear_words(&result);
+				return FALSE;
+			}
+
+			result.word[result.count] = nmalloc(headlen + taillen + 1);
+			strcpy(result.word[result.count], run->word[i]);
+			strcpy(result.word[result.count++] + headlen, tail->word[j]);
+		}
+
+	clear_words(run);
+	*run = result;
+
+	return TRUE;
+}
+
+/* When the given candidate set is usable (no empty string in it) and better
+ * than the best one so far (its shortest string is longer, or it has fewer
+ * strings), make it the best one. */
+void consider_words(wordset *best, bool *have_best, const wordset *candidate)
+{
+	size_t shortest = MAX_WORD_LEN + 1, best_shortest = 0;
+
+	for (int i = 0; i < candidate->count; i++)
+		if (strlen(candidate->word[i]) < shortest)
+			shortest = strlen(candidate->word[i]);
+
+	if (candidate->count == 0 || shortest == 0)
+		return;
+
+	for (int i = 0; *have_best && i < best->count; i++)
+		if (i == 0 || strlen(best->word[i]) < best_shortest)
+			best_shortest = strlen(best->word[i]);
+
+	if (*have_best && (shortest < best_shortest ||
+				(shortest == best_shortest && candidate->count >= best->count)))
+		return;
+
+	copy_words(best, candidate);
+	*have_best = TRUE;
+}
+
+/* Scan a bracket expression.  When it consists of only a few plain ASCII
+ * characters, put these into set as single-character strings. */
+bool scan_bracket(const char **regex, wordset *set, bool *is_exact)
+{
+	bool chosen[128] = {FALSE};
+	bool plain = TRUE;
+	const char *p = *regex + 1;
+	int count = 0;
+
+	if (*p == '^') {
+		plain = FALSE;
+		p++;
+	}
+
+	/* A closing bracket right at the start is an ordinary member. */
+	for (bool first = TRUE; *p && (*p != ']' || first); first = FALSE) {
+		unsigned char here = *p, there = (p[1] == '-') ? p[2] : '\0';
+
+		/* Skip over a character class, equivalence class, or collating element. */
+		if (here == '[' && (p[1] == ':' || p[1] == '=' || p[1] == '.')) {
+			const char *closing = p + 2;
+
+			while (*closing && (closing[0] != p[1] || closing[1] != ']'))
+				closing++;
+			if (*closing == '\0')
+				return FALSE;
+
+			p = closing + 2;
+			plain = FALSE;
+			continue;
+		}
+
+		if (here >= 0x80)
+			plain = FALSE;
+		else if (there && there != ']') {
+			/* Accept only ranges of digits, or of letters of the same case. */
+			if ((isdigit(here) && isdigit(there)) || (islower(here) && islower(there)) ||
+							(isupper(here) && isupper(there))) {
+				for (int ch = here; ch <= there; ch++)
+					chosen[tolower(ch)] = TRUE;
+			} else
+				plain = FALSE;
+			p += 3;
+			continue;
+		} else
+			chosen[tolower(here)] = TRUE;
+
+		p++;
+	}
+
+	if (*p != ']')
+		return FALSE;
+
+	*regex = p + 1;
+
+	for (int ch = 1; ch < 128; ch++)
+		count += chosen[ch];
+
+	*is_exact = (plain && count > 0 && count <= MAX_WORDS);
+
+	for (int ch = 1; *is_exact && ch < 128; ch++)
+		if (chosen[ch]) {
+			set->word[set->count] = nmalloc(2);
+			set->word[set->count][0] = ch;
+			set->word[set->count++][1] = '\0';
+		}
+
+	return TRUE;
+}
+
+/* Scan a single atom of a regex.  When it can only match certain strings, put
+ * those into exact; otherwise, if known, put into needed a set of strings of
+ * which any match contains at least one. */
+bool scan_atom(const char **regex, wordset *exact, bool *is_exact,
+								wordset *needed, bool *has_needed)
+{
+	unsigned char ch = **regex;
+
+	*is_exact = FALSE;
+	*has_needed = FALSE;
+
+	if (ch == '(') {
+		(*regex)++;
+		if (!scan_alternation(regex, exact, is_exact, needed, has_needed) || **regex != ')')
+			return FALSE;
+		(*regex)++;
+		return TRUE;
+	} else if (ch == '[')
+		return scan_bracket(regex, exact, is_exact);
+
+	(*regex)++;
+
+	/* A backslash quotes a punctuation character, or makes
+	 * an anchor, a character class, or a back reference. */
+	if (ch == '\\') {
+		ch = **regex;
+		if (ch == '\0')
+			return FALSE;
+		(*regex)++;
+		if (strchr("<>bB`'", ch)) {
+			set_to_empty(exact);
+			*is_exact = TRUE;
+			return TRUE;
+		} else if (ch >= 0x80 || isalnum(ch))
+			return TRUE;
+	} else if (ch == '^' || ch == '$') {
+		set_to_empty(exact);
+		*is_exact = TRUE;
+		return TRUE;
+	} else if (ch == '.' || strchr("*+?{", ch) || ch >= 0x80)
+		/* A period, a stray operator, or a byte of a multibyte character
+		 * could match too many things to be of use. */
+		return TRUE;
+
+	exact->word[0] = nmalloc(2);
+	exact->word[0][0] = tolower(ch);
+	exact->word[0][1] = '\0';
+	exact->count = 1;
+	*is_exact = TRUE;
+
+	return TRUE;
+}
+
+/* Scan the repetition operators that follow an atom, if any.  Set least to
+ * the minimum number of times that the atom occurs, and once to whether it
+ * can occur at most once. */
+bool scan_repetition(const char **regex, int *least, bool *once)
+{
+	*least = 1;
+	*once = TRUE;
+
+	while (TRUE) {
+		if (**regex == '*') {
+			*least = 0;
+			*once = FALSE;
+		} else if (**regex == '+')
+			*once = FALSE;
+		else if (**regex == '?')
+			*least = 0;
+		else if (**regex == '{') {
+			const char *p = *regex + 1;
+			int minimum = 0, maximum;
+
+			if (!isdigit((unsigned char)*p))
+				return FALSE;
+			while (isdigit((unsigned char)*p))
+				minimum = minimum * 10 + (*p++ - '0');
+
+			maximum = minimum;
+			if (*p == ',') {
+				p++;
+				maximum = (isdigit((unsigned char)*p)) ? 0 : -1;
+				while (isdigit((unsigned char)*p))
+					maximum = maximum * 10 + (*p++ - '0');
+			}
+
+			if (*p != '}')
+				return FALSE;
+
+			*least *= minimum;
+			*once &= (maximum == 1);
+			*regex = p;
+		} else
+			return TRUE;
+
+		(*regex)++;
+	}
+}
+
+/* Scan a sequence of atoms, up to a bar or closing parenthesis.  Consecutive
+ * atoms with known strings form runs, and the best run becomes needed. */
+bool scan_sequence(const char **regex, wordset *exact, bool *is_exact,
+								wordset *needed, bool *has_needed)
+{
+	wordset piece = {.count = 0}, hint = {.count = 0};
+	bool piece_exact, have_hint;
+	int least;
+	bool once;
+
+	set_to_empty(exact);
+	*is_exact = TRUE;
+	*has_needed = FALSE;
+
+	while (**regex && **regex != '|' && **regex != ')') {
+		if (!scan_atom(regex, &piece, &piece_exact, &hint, &have_hint) ||
+						!scan_repetition(regex, &least, &once)) {
+			clear_words(&piece);
+			clear_words(&hint);
+			return FALSE;
+		}
+
+		if (piece_exact && least == 0 && once) {
+			/* An optional atom with known strings can still extend the run. */
+			wordset nothing;
+
+			set_to_empty(&nothing);
+			piece_exact = merge_words(&piece, &nothing);
+			clear_words(&nothing);
+			have_hint = FALSE;
+		} else if (least == 0)
+			piece_exact = have_hint = FALSE;
+
+		if (piece_exact && once && join_words(exact, &piece)) {
+			clear_words(&piece);
+			clear_words(&hint);
+			continue;
+		} else if (piece_exact && !once) {
+			/* A repeated atom extends the run once, and then ends it. */
+			join_words(exact, &piece);
+			consider_words(needed, has_needed, exact);
+			consider_words(needed, has_needed, &piece);
+			piece_exact = FALSE;
+		} else
+			consider_words(needed, has_needed, exact);
+
+		if (have_hint)
+			consider_words(needed, has_needed, &hint);
+
+		/* The run is broken; a new one starts with the current atom
+		 * when its strings are known, otherwise after it. */
+		clear_words(exact);
+		if (piece_exact)
+			*exact = piece;
+		else {
+			set_to_empty(exact);
+			clear_words(&piece);
+		}
+		piece.count = 0;
+		clear_words(&hint);
+		*is_exact = FALSE;
+	}
+
+	consider_words(needed, has_needed, exact);
+
+	return TRUE;
+}
+
+/* Scan a list of alternatives.  The alternation has known strings only when
+ * each alternative has, and has needed strings only when each alternative has. */
+bool scan_alternation(const char **regex, wordset *exact, bool *is_exact,
+								wordset *needed, bool *has_needed)
+{
+	wordset other = {.count = 0}, other_needed = {.count = 0};
+	bool other_exact, other_has;
+
+	if (!scan_sequence(regex, exact, is_exact, needed, has_needed))
+		return FALSE;
+
+	while (**regex == '|') {
+		(*regex)++;
+
+		if (!scan_sequence(regex, &other, &other_exact, &other_needed, &other_has)) {
+			clear_words(&other);
+			clear_words(&other_needed);
+			return FALSE;
+		}
+
+		*is_exact = *is_exact && other_exact && merge_words(exact, &other);
+		*has_needed = *has_needed && other_has && merge_words(needed, &other_needed);
+
+		clear_words(&other);
+		clear_words(&other_needed);
+	}
+
+	return TRUE;
+}
+
+/* Determine a set of literal strings of which any match of the given regex
+ * must contain at least one.  Return them folded to lowercase, each followed
+ * by a NUL, with an extra NUL at the end; or NULL when there is no such set. */
+char *literals_in(const char *regex)
+{
+	wordset exact = {.count = 0}, needed = {.count = 0};
+	bool is_exact, has_needed = FALSE;
+	char *literals = NULL;
+	size_t size = 1;
+
+	if (scan_alternation(&regex, &exact, &is_exact, &needed, &has_needed) &&
+													*regex == '\0' && has_needed) {
+		for (int i = 0; i < needed.count; i++)
+			size += strlen(needed.word[i]) + 1;
+
+		literals = nmalloc(size);
+		size = 0;
+
+		for (int i = 0; i < needed.count; i++) {
+			strcpy(literals + size, needed.word[i]);
+			size += strlen(needed.word[i]) + 1;
+		}
+
+		literals[size] = '\0';
+	}
+
+	clear_words(&exact);
+	clear_words(&needed);
+
+	return literals;
+}
+
+/* Add the given clue to the list of the given state, unless it is there already. */
+void add_clue(sievetype *sieve, short clue, int state, size_t *listed, size_t *room)
+{
+	for (size_t i = sieve->from[state]; i < *listed; i++)
+		if (sieve->clues[i] == clue)
+			return;
+
+	if (*listed == *room) {
+		*room *= 2;
+		sieve->clues = nrealloc(sieve->clues, *room * sizeof(short));
+	}
+
+	sieve->clues[(*listed)++] = clue;
+}
+
+/* Build an automaton (after Aho and Corasick) that finds in one pass over a line
+ * which of the given sets of literals occur in it.  Each set that is not NULL gets
+ * a number (a clue) in the corresponding element of clues; the others get -1. */
+sievetype *build_a_sieve(char **sets, short *clues, int count)
+{
+	sievetype *sieve = nmalloc(sizeof(sievetype));
+	size_t states = 1, total = 1, words = 0, listed = 0, room;
+	int *failure, *queue, *next_owned, *first_owned;
+	short *clue_of;
+	const char *word;
+
+	sieve->count = 0;
+	sieve->kinds = 1;
+	memset(sieve->kind, 0, sizeof(sieve->kind));
+
+	/* Number the sets of literals, and give each byte in them a class. */
+	for (int set = 0; set < count; set++) {
+		clues[set] = (sets[set]) ? sieve->count++ : -1;
+
+		for (word = (sets[set]) ? sets[set] : ""; *word; word += strlen(word) + 1, words++)
+			for (const char *byte = word; *byte; byte++, total++)
+				if (sieve->kind[(unsigned char)*byte] == 0)
+					sieve->kind[(unsigned char)*byte] = sieve->kinds++;
+	}
+
+	/* Let uppercase ASCII letters fall into the class of their lowercase forms. */
+	for (int ch = 'A'; ch <= 'Z'; ch++)
+		sieve->kind[ch] = sieve->kind[tolower(ch)];
+
+	sieve->found = nmalloc(sieve->count + 1);
+
+	/* With too many states for the table, nothing gets skipped. */
+	if (sieve->count == 0 || total > 0xFFFF) {
+		for (int set = 0; set < count; set++)
+			clues[set] = -1;
+		sieve->count = 0;
+		return sieve;
+	}
+
+	sieve->jump = nmalloc(total * sieve->kinds * sizeof(unsigned short));
+	failure = nmalloc(total * sizeof(int));
+	queue = nmalloc(total * sizeof(int));
+	first_owned = nmalloc(total * sizeof(int));
+	next_owned = nmalloc(words * sizeof(int));
+	clue_of = nmalloc(words * sizeof(short));
+	words = 0;
+
+	for (size_t i = 0; i < total * sieve->kinds; i++)
+		sieve->jump[i] = 0xFFFF;
+	for (size_t i = 0; i < total; i++)
+		first_owned[i] = -1;
+
+	/* Put all literals into a trie, remembering which set each one belongs to. */
+	for (int set = 0; set < count; set++)
+		for (word = (sets[set]) ? sets[set] : ""; *word; word += strlen(word) + 1) {
+			size_t state = 0;
+
+			for (const char *byte = word; *byte; byte++) {
+				unsigned short *step = &sieve->jump[state * sieve->kinds +
+											sieve->kind[(unsigned char)*byte]];
+				if (*step == 0xFFFF)
+					*step = states++;
+				state = *step;
+			}
+
+			clue_of[words] = clues[set];
+			next_owned[words] = first_owned[state];
+			first_owned[state] = words++;
+		}
+
+	sieve->from = nmalloc(states * sizeof(int));
+	sieve->upto = nmalloc(states * sizeof(int));
+	room = words + 1;
+	sieve->clues = nmalloc(room * sizeof(short));
+
+	/* Go through the trie breadth first, filling in the missing transitions
+	 * with those of the failure state, and give each state the clues of the
+	 * literals that end in it plus those that its failure state recognizes. */
+	queue[0] = 0;
+	failure[0] = 0;
+
+	for (size_t head = 0, tail = 1; head < tail; head++) {
+		int state = queue[head];
+
+		sieve->from[state] = listed;
+
+		for (int item = first_owned[state]; item >= 0; item = next_owned[item])
+			add_clue(sieve, clue_of[item], state, &listed, &room);
+
+		if (state > 0)
+			for (int i = sieve->from[failure[state]]; i < sieve->upto[failure[state]]; i++)
+				add_clue(sieve, sieve->clues[i], state, &listed, &room);
+
+		sieve->upto[state] = listed;
+
+		for (int kind = 0; kind < sieve->kinds; kind++) {
+			unsigned short *step = &sieve->jump[state * sieve->kinds + kind];
+
+			if (*step == 0xFFFF)
+				*step = (state == 0) ? 0 : sieve->jump[failure[state] * sieve->kinds + kind];
+			else {
+				failure[*step] = (state == 0) ? 0 : sieve->jump[failure[state] * sieve->kinds + kind];
+				queue[tail++] = *step;
+			}
+		}
+	}
+
+	free(failure);
+	free(queue);
+	free(first_owned);
+	free(next_owned);
+	free(clue_of);
+
+	return sieve;
+}
+
+/* Build for the given syntax the automaton that looks for the literals of its
+ * single-line rules, and the one that looks for those of the start and end
+ * regexes of its multiline rules. */
+void build_the_sieves(syntaxtype *sntx)
+{
+	int count = 0, index = 0;
+	char **sets;
+	short *clues;
+	colortype *ink;
+
+	for (ink = sntx->color; ink != NULL; ink = ink->next)
+		count++;
+
+	sets = nmalloc((2 * count + 1) * sizeof(char *));
+	clues = nmalloc((2 * count + 1) * sizeof(short));
+
+	for (ink = sntx->color; ink != NULL; ink = ink->next)
+		sets[index++] = (ink->end == NULL) ? ink->literals : NULL;
+
+	sntx->sieve = build_a_sieve(sets, clues, count);
+
+	index = 0;
+	for (ink = sntx->color; ink != NULL; ink = ink->next)
+		ink->clue = clues[index++];
+
+	/* For a multiline rule, the literals of its start and end regex form two sets.
+	 * (When there is just one such rule, its regexes are as quick at finding them.) */
+	for (ink = sntx->color; ink != NULL; ink = ink->next)
+		if (ink->end) {
+			sets[2 * ink->id] = (sntx->multiscore > 1) ? ink->literals : NULL;
+			sets[2 * ink->id + 1] = (sntx->multiscore > 1) ? ink->endliterals : NULL;
+		}
+
+	sntx->multisieve = build_a_sieve(sets, clues, 2 * sntx->multiscore);
+
+	for (ink = sntx->color; ink != NULL; ink = ink->next)
+		if (ink->end) {
+			ink->clue = clues[2 * ink->id];
+			ink->endclue = clues[2 * ink->id + 1];
+		}
+
+	free(sets);
+	free(clues);
+}
+
+/* Determine which sets of literals of the given sieve occur somewhere in the
+ * given text, by looking for all of them at once.  The result is left in the
+ * given array (normally the 'found' array of the sieve), indexed by clue. */
+void sift_the_line(const sievetype *sieve, const char *text, bool *found)
+{
+	int missing = sieve->count;
+	int state = 0;
+
+	memset(found, FALSE, sieve->count);
+
+	while (*text && missing > 0) {
+		state = sieve->jump[state * sieve->kinds + sieve->kind[(unsigned char)*text++]];
+
+		for (int i = sieve->from[state]; i < sieve->upto[state]; i++)
+			if (!found[sieve->clues[i]]) {
+				found[sieve->clues[i]] = TRUE;
+				missing--;
+			}
+	}
+}
+
 /* Find a syntax that applies to the current buffer, based upon filename
  * or buffer content, and load and prime this syntax when needed. */
 void find_and_prime_applicable_syntax(void)
@@ -227,6 +828,10 @@ void find_and_prime_applicable_syntax(void)
 		set_syntax_colorpairs(sntx);
 	}
 
+	/* When not done yet, gather the literals of the rules into automatons. */
+	if (sntx && sntx->sieve == NULL)
+		build_the_sieves(sntx);
+
 	openfile->syntax = sntx;
 }
 
@@ -243,7 +848,7 @@ void check_the_multis(linestruct *line)
 	if (!openfile->syntax || openfile->syntax->multiscore == 0)
 		return;
 
-	if (line->multidata == NULL) {
+	if (!HAS_MULTIDATA(line)) {
 		refresh_needed = TRUE;
 		return;
 	}
@@ -258,21 +863,21 @@ void check_the_multis(linestruct *line)
 		anend = (regexec(ink->end, afterstart, 1, &endmatch, 0) == 0);
 
 		/* Check whether the multidata still matches the current situation. */
-		if (line->multidata[ink->id] == NOTHING) {
+		if (MULTIDATA(line)[ink->id] == NOTHING) {
 			if (!astart)
 				continue;
-		} else if (line->multidata[ink->id] == WHOLELINE) {
+		} else if (MULTIDATA(line)[ink->id] == WHOLELINE) {
 			/* Ensure that a detected start match is not actually an end match. */
 			if (!anend && (!astart || regexec(ink->end, line->data, 1, &endmatch, 0) != 0))
 				continue;
-		} else if (line->multidata[ink->id] == JUSTONTHIS) {
+		} else if (MULTIDATA(line)[ink->id] == JUSTONTHIS) {
 			if (astart && anend && regexec(ink->start, line->data + startmatch.rm_eo +
 											endmatch.rm_eo, 1, &startmatch, 0) != 0)
 				continue;
-		} else if (line->multidata[ink->id] == STARTSHERE) {
+		} else if (MULTIDATA(line)[ink->id] == STARTSHERE) {
 			if (astart && !anend)
 				continue;
-		} else if (line->multidata[ink->id] == ENDSHERE) {
+		} else if (MULTIDATA(line)[ink->id] == ENDSHERE) {
 			if (!astart && anend)
 				continue;
 		}
@@ -284,94 +889,554 @@ void check_the_multis(linestruct *line)
 	}
 }
 
-/* Precalculate the multi-line start and end regex info so we can
- * speed up rendering (with any hope at all...). */
-void precalc_multicolorinfo(void)
+/* Whether the given multiline-regex info leaves a match open at the end of its line. */
+#define STILL_OPEN(info)  (info == STARTSHERE || info == WHOLELINE)
+
+/* Determine the multiline-regex info of the given regex for the given line,
+ * taking into account whether a match is still open from an earlier line.
+ * The found array tells which literals of the multiline regexes occur on
+ * the line, as determined by sift_the_line(). */
+short multi_info_of(const colortype *ink, const linestruct *line, bool open,
+						const bool *found)
 {
-	const colortype *ink;
+	bool can_start = (ink->clue < 0 || found[ink->clue]);
+	bool can_end = (ink->endclue < 0 || found[ink->endclue]);
 	regmatch_t startmatch, endmatch;
-	linestruct *line, *tailline;
+	short info = NOTHING;
+	int index = 0;
 
-	if (!openfile->syntax || openfile->syntax->multiscore == 0 || ISSET(NO_SYNTAX))
+	/* When a match that started on an earlier line is still open,
+	 * the line is wholly covered unless it contains the end. */
+	if (open) {
+		if (!can_end || regexec(ink->end, line->data, 1, &endmatch, 0) != 0)
+			return WHOLELINE;
+
+		info = ENDSHERE;
+
+		/* Look for a possible new start after the end match. */
+		index = endmatch.rm_eo;
+	}
+
+	/* When the line contains a start match, look for an end after it. */
+	while (can_start && regexec(ink->start, line->data + index, 1, &startmatch,
+								(index == 0) ? 0 : REG_NOTBOL) == 0) {
+		/* Begin looking for an end match after the start match. */
+		index += startmatch.rm_eo;
+
+		/* Without an end match on this same line, the match stays open. */
+		if (!can_end || regexec(ink->end, line->data + index, 1, &endmatch,
+								(index == 0) ? 0 : REG_NOTBOL) != 0)
+			return STARTSHERE;
+
+		/* Mark the line, but continue looking for other starts after it. */
+		info = JUSTONTHIS;
+
+		index += endmatch.rm_eo;
+
+		/* If the total match has zero length, force an advance. */
+		if (startmatch.rm_eo - startmatch.rm_so + endmatch.rm_eo == 0) {
+			/* When at end-of-line, there is no other start. */
+			if (line->data[index] == '\0')
+				break;
+			index = step_right(line->data, index);
+		}
+	}
+
+	return info;
+}
+
+#ifndef NANO_TINY
+/* Note that the multiline info of the lines with the given numbers, and of
+ * those in between, may be wrong, so that the next recalculation redoes it. */
+void mark_stale_lines(ssize_t first, ssize_t last)
+{
+	if (first < openfile->stale_from)
+		openfile->stale_from = first;
+	if (last > openfile->stale_upto)
+		openfile->stale_upto = last;
+}
+
+/* Let the marked range of lines follow a renumbering: the lines from the given
+ * (old) number onward have shifted by the given amount. */
+void shift_stale_lines(ssize_t from, ssize_t by)
+{
+	if (openfile->stale_from > openfile->stale_upto)
 		return;
 
+	if (openfile->stale_from >= from)
+		openfile->stale_from += by;
+	if (openfile->stale_upto >= from)
+		openfile->stale_upto += by;
+}
+#endif
+
+/* Mark the given line as changed, so that its multiline info gets redone. */
+void mark_as_stale(linestruct *line)
+{
+	line->stale = TRUE;
+#ifndef NANO_TINY
+	/* A line without a number is not (yet) part of the current buffer;
+	 * when it gets added, the renumbering marks it. */
+	if (openfile && line->stamp != 0)
+		mark_stale_lines(lineno_of(line), lineno_of(line));
+#endif
+}
+
+/* Give the given line room for the multiline-regex info of the current syntax:
+ * inside the node when it fits there, otherwise in an allocation of its own. */
+void provide_multidata(linestruct *line)
+{
+	line->boxed = (openfile->syntax->multiscore <= MULTIBOX);
+
+	if (!line->boxed)
+		line->multidata = nmalloc(openfile->syntax->multiscore * sizeof(short));
+}
+
+/* Free the multiline-regex info of the given line, if it has any. */
+void discard_multidata(linestruct *line)
+{
+	if (!line->boxed)
+		free(line->multidata);
+
+	line->multidata = NULL;
+	line->boxed = FALSE;
+}
+
+/* Bring the multiline-regex info of the lines from the given one onward up
+ * to date, assuming that the lines before are correct.  All multiline regexes
+ * are handled together, line by line: from a line that changed, each regex gets
+ * redone until a line that has not changed turns out to leave a match of it
+ * open or closed just as before, and then it rests until the next change. */
+void recolor_from(linestruct *line)
+{
+	sievetype *sieve = openfile->syntax->multisieve;
+	short multis = openfile->syntax->multiscore;
+	const colortype **every = nmalloc(multis * sizeof(colortype *));
+		/* All the multiline regexes of the current syntax. */
+	const colortype **busy = nmalloc(multis * sizeof(colortype *));
+		/* The multiline regexes whose info is being redone. */
+	short active = 0, kept;
+		/* How many regexes are being redone, and how many will continue. */
+	const colortype *ink;
+	short former;
+	bool open;
+#ifndef NANO_TINY
+	ssize_t number = lineno_of(line);
+		/* The number of the line that is being looked at. */
+	ssize_t last = (openfile->hugefile ? HIGHEST_POSITIVE : openfile->stale_upto);
+		/* The last line that may have changed; the lines of a huge file
+		 * are not tracked. */
+#endif
+
 //#define TIMEPRECALC  123
 #ifdef TIMEPRECALC
-#include <time.h>
 	clock_t start = clock();
+	size_t redone = 0;
 #endif
 
-	/* For each line, allocate cache space for the multiline-regex info. */
-	for (line = openfile->filetop; line != NULL; line = line->next)
-		if (!line->multidata)
-			line->multidata = nmalloc(openfile->syntax->multiscore * sizeof(short));
+	for (ink = openfile->syntax->color; ink != NULL; ink = ink->next)
+		if (ink->end)
+			every[ink->id] = ink;
 
-	for (ink = openfile->syntax->color; ink != NULL; ink = ink->next) {
-		/* If this is not a multi-line regex, skip it. */
-		if (ink->end == NULL)
+	for (; line != NULL; line = line->next) {
+#ifndef NANO_TINY
+		/* Beyond the last changed line, once all regexes have settled, stop. */
+		if (active == 0 && number > last)
+			break;
+
+		number++;
+#endif
+		/* A line that is new in the buffer gets a cache and counts as changed. */
+		if (!HAS_MULTIDATA(line)) {
+			provide_multidata(line);
+			line->stale = TRUE;
+		}
+
+		/* From a changed line onward, every multiline regex must be redone. */
+		if (line->stale) {
+			memcpy(busy, every, multis * sizeof(colortype *));
+			active = multis;
+		}
+
+		/* Skip the lines whose info is still valid. */
+		if (active == 0)
 			continue;
 
-		for (line = openfile->filetop; line != NULL; line = line->next) {
-			int index = 0;
+		/* Find out which start and end regexes could match on this line at all,
+		 * so that only those need to be tried. */
+		if (sieve->count > 0)
+			sift_the_line(sieve, line->data, sieve->found);
+
+		for (short index = kept = 0; index < active; index++) {
+			ink = busy[index];
+			open = (line->prev && STILL_OPEN(MULTIDATA(line->prev)[ink->id]));
+			former = MULTIDATA(line)[ink->id];
+			MULTIDATA(line)[ink->id] = multi_info_of(ink, line, open, sieve->found);
+
+			/* When the state after an unchanged line is the same as before,
+			 * the info of the lines that follow is still right. */
+			if (line->stale || STILL_OPEN(former) != STILL_OPEN(MULTIDATA(line)[ink->id]))
+				busy[kept++] = ink;
+		}
 
-			/* Assume nothing applies until proven otherwise below. */
-			line->multidata[ink->id] = NOTHING;
+		active = kept;
 
-			/* When the line contains a start match, look for an end,
-			 * and if found, mark all the lines that are affected. */
-			while (regexec(ink->start, line->data + index, 1, &startmatch,
-										(index == 0) ? 0 : REG_NOTBOL) == 0) {
-				/* Begin looking for an end match after the start match. */
-				index += startmatch.rm_eo;
+		line->stale = FALSE;
+#ifdef TIMEPRECALC
+		redone++;
+#endif
+	}
 
-				/* If there is an end match on this same line, mark the line,
-				 * but continue looking for other starts after it. */
-				if (regexec(ink->end, line->data + index, 1, &endmatch,
-										(index == 0) ? 0 : REG_NOTBOL) == 0) {
-					line->multidata[ink->id] = JUSTONTHIS;
+	free(every);
+	free(busy);
 
-					index += endmatch.rm_eo;
+#ifdef TIMEPRECALC
+	statusline(NOTICE, "Precalculation: %zu lines in %.1f ms", redone,
+						1000 * (double)(clock() - start) / CLOCKS_PER_SEC);
+#endif
+}
 
-					/* If the total match has zero length, force an advance. */
-					if (startmatch.rm_eo - startmatch.rm_so + endmatch.rm_eo == 0) {
-						/* When at end-of-line, there is no other start. */
-						if (line->data[index] == '\0')
-							break;
-						index = step_right(line->data, index);
-					}
+/* The multiline regexes of the current syntax, indexed by their number,
+ * the number of threads among which they get divided, and for each thread
+ * an array in which to note the literals that a line contains. */
+static const colortype **gang = NULL;
+static int crew = 1;
+static bool **findings = NULL;
+
+/* Calculate the multiline-regex info of all lines of the buffer for each
+ * regex whose number, modulo the number of threads, is the given share.
+ * As the regexes are independent, a thread writes only the elements of
+ * its own regexes, and each regex is used by a single thread. */
+static DWORD WINAPI recolor_share(LPVOID share)
+{
+	const sievetype *sieve = openfile->syntax->multisieve;
+	short multis = openfile->syntax->multiscore;
+	short first = (short)(intptr_t)share;
+	bool *found = findings[first];
+	bool open;
+
+	for (linestruct *line = openfile->filetop; line != NULL; line = line->next) {
+		if (sieve->count > 0)
+			sift_the_line(sieve, line->data, found);
+
+		for (short id = first; id < multis; id += crew) {
+			open = (line->prev && STILL_OPEN(MULTIDATA(line->prev)[id]));
+			MULTIDATA(line)[id] = multi_info_of(gang[id], line, open, found);
+		}
+	}
 
-					continue;
-				}
+	return 0;
+}
 
-				/* Look for an end match on later lines. */
-				tailline = line->next;
+/* Calculate the multiline-regex info of the whole buffer from scratch, with
+ * the regexes divided among as many threads as there are processors.  Return
+ * FALSE (having done nothing) when there is just one processor or regex. */
+bool recolor_in_parallel(void)
+{
+	short multis = openfile->syntax->multiscore;
+	HANDLE *threads;
+	SYSTEM_INFO system;
+	const colortype *ink;
 
-				while (tailline && regexec(ink->end, tailline->data, 1, &endmatch, 0) != 0)
-					tailline = tailline->next;
+	GetSystemInfo(&system);
 
-				line->multidata[ink->id] = STARTSHERE;
+	crew = (system.dwNumberOfProcessors < (DWORD)multis) ?
+						(int)system.dwNumberOfProcessors : multis;
 
-				// Note that this also advances the line in the main loop.
-				for (line = line->next; line != tailline; line = line->next)
-					line->multidata[ink->id] = WHOLELINE;
+	if (crew < 2)
+		return FALSE;
 
-				if (tailline == NULL) {
-					line = openfile->filebot;
-					break;
-				}
+	/* Give every line a cache first, so that the threads just fill it in. */
+	for (linestruct *line = openfile->filetop; line != NULL; line = line->next) {
+		if (!HAS_MULTIDATA(line))
+			provide_multidata(line);
+		line->stale = FALSE;
+	}
 
-				tailline->multidata[ink->id] = ENDSHERE;
+	gang = nmalloc(multis * sizeof(colortype *));
+	findings = nmalloc(crew * sizeof(bool *));
+	threads = nmalloc(crew * sizeof(HANDLE));
 
-				/* Look for a possible new start after the end match. */
-				index = endmatch.rm_eo;
-			}
+	for (ink = openfile->syntax->color; ink != NULL; ink = ink->next)
+		if (ink->end)
+			gang[ink->id] = ink;
+
+	for (int share = 0; share < crew; share++)
+		findings[share] = nmalloc(openfile->syntax->multisieve->count + 1);
+
+	/* Start a thread for each share but the first, which is done here.
+	 * A share for which no thread could be started is done here too. */
+	for (int share = 1; share < crew; share++)
+		threads[share] = CreateThread(NULL, 0, recolor_share,
+										(LPVOID)(intptr_t)share, 0, NULL);
+
+	recolor_share((LPVOID)0);
+
+	for (int share = 1; share < crew; share++) {
+		if (threads[share] == NULL)
+			recolor_share((LPVOID)(intptr_t)share);
+		else {
+			WaitForSingleObject(threads[share], INFINITE);
+			CloseHandle(threads[share]);
 		}
 	}
 
-#ifdef TIMEPRECALC
-	statusline(NOTICE, "Precalculation: %.1f ms", 1000 * (double)(clock() - start) / CLOCKS_PER_SEC);
-	napms(1200);
+	for (int share = 0; share < crew; share++)
+		free(findings[share]);
+
+	free(threads);
+	free(findings);
+	free(gang);
+	findings = NULL;
+	gang = NULL;
+
+	return TRUE;
+}
+
+/* Precalculate the multiline-regex info for the lines from the given one
+ * onward, assuming that the info of the lines before it is still valid. */
+void precalc_multicolorinfo_from(linestruct *line)
+{
+	if (!openfile->syntax || openfile->syntax->multiscore == 0 || ISSET(NO_SYNTAX))
+		return;
+
+	/* Without info for the preceding line, everything must be calculated. */
+	if (line->prev && !HAS_MULTIDATA(line->prev)) {
+		precalc_multicolorinfo();
+		return;
+	}
+
+	line->stale = TRUE;
+
+	recolor_from(line);
+}
+
+/* Precalculate the multi-line start and end regex info so we can speed
+ * up rendering (with any hope at all...).  Only the lines that changed
+ * since the last time, and the ones affected by them, get recomputed. */
+void precalc_multicolorinfo(void)
+{
+	linestruct *line = openfile->filetop;
+
+	if (!openfile->syntax || openfile->syntax->multiscore == 0 || ISSET(NO_SYNTAX))
+		return;
+
+#ifndef NANO_TINY
+	/* When all lines have info, start at the first line that may have changed.
+	 * (The lines of a huge file are not tracked, so there do them all.) */
+	if (HAS_MULTIDATA(line) && !openfile->hugefile) {
+		if (openfile->stale_from > openfile->stale_upto)
+			return;
+
+		if (openfile->stale_from > line->lineno)
+			line = line_from_number(openfile->stale_from < lineno_of(openfile->filebot) ?
+										openfile->stale_from : lineno_of(openfile->filebot));
+
+		if (line->prev && !HAS_MULTIDATA(line->prev))
+			line = openfile->filetop;
+	}
+#endif
+
+	/* When no line has any info yet, let several threads work on it. */
+	if (HAS_MULTIDATA(line) || !recolor_in_parallel())
+		recolor_from(line);
+
+#ifndef NANO_TINY
+	openfile->stale_from = HIGHEST_POSITIVE;
+	openfile->stale_upto = 0;
 #endif
 }
 
+/* The maximum number of lines whose coloring is remembered. */
+#define MAX_PAINTED  4000
+
+/* The remembered colorings, from the most recently drawn line to the least. */
+static painttype *newest_paint = NULL;
+static painttype *oldest_paint = NULL;
+/* The number of lines that have a remembered coloring. */
+static size_t paintings = 0;
+
+/* The number of slots in the table that finds the coloring of a line. */
+#define PAINT_SLOTS  4096
+
+/* The remembered colorings, hashed by the address of their line, so that
+ * a line does not need to carry a pointer to its coloring. */
+static painttype *paint_table[PAINT_SLOTS];
+
+/* Return the slot in the table of colorings for the given line. */
+painttype **slot_of(const linestruct *line)
+{
+	return &paint_table[((uintptr_t)line / sizeof(linestruct)) % PAINT_SLOTS];
+}
+
+/* Return the remembered coloring of the given line, or NULL when it has none. */
+painttype *painting_of(const linestruct *line)
+{
+	painttype *paint = *slot_of(line);
+
+	while (paint && paint->line != line)
+		paint = paint->sibling;
+
+	return paint;
+}
+
+/* Take the given coloring out of the table of colorings. */
+void unhash_paint(painttype *paint)
+{
+	painttype **link = slot_of(paint->line);
+
+	while (*link != paint)
+		link = &(*link)->sibling;
+
+	*link = paint->sibling;
+}
+
+/* Take the given coloring out of the chain of remembered colorings. */
+void unchain_paint(painttype *paint)
+{
+	if (paint->newer)
+		paint->newer->older = paint->older;
+	else
+		newest_paint = paint->older;
+
+	if (paint->older)
+		paint->older->newer = paint->newer;
+	else
+		oldest_paint = paint->newer;
+}
+
+/* Put the given coloring at the head of the chain, as the most recent one. */
+void chain_paint(painttype *paint)
+{
+	paint->newer = NULL;
+	paint->older = newest_paint;
+
+	if (newest_paint)
+		newest_paint->newer = paint;
+	else
+		oldest_paint = paint;
+
+	newest_paint = paint;
+}
+
+/* Return the multidata of the line before the given one for the given rule,
+ * where a line without a predecessor counts as being preceded by nothing. */
+short info_before(const linestruct *line, short id)
+{
+	return (line->prev && HAS_MULTIDATA(line->prev)) ? MULTIDATA(line->prev)[id] : NOTHING;
+}
+
+/* Return TRUE when the given coloring of the given line was determined with
+ * the current syntax and the same state of the preceding line, and covers
+ * at least the part of the line up to the given index. */
+bool still_right(const painttype *paint, const linestruct *line, size_t reach)
+{
+	if (paint == NULL || paint->syntax != openfile->syntax || paint->reach < reach)
+		return FALSE;
+
+	if (openfile->syntax->multiscore > 0 && !HAS_MULTIDATA(line))
+		return FALSE;
+
+	for (short id = 0; id < openfile->syntax->multiscore; id++)
+		if (paint->context[id] != info_before(line, id))
+			return FALSE;
+
+	return TRUE;
+}
+
+/* Return the remembered coloring of the given line when it is still right
+ * for the part up to the given index, and NULL otherwise. */
+const painttype *paint_of(linestruct *line, size_t reach)
+{
+	painttype *paint = painting_of(line);
+
+	if (!still_right(paint, line, reach))
+		return NULL;
+
+	unchain_paint(paint);
+	chain_paint(paint);
+
+	return paint;
+}
+
+/* Return TRUE when the given line has a remembered coloring that is still right. */
+bool is_painted(const linestruct *line)
+{
+	return still_right(painting_of(line), line, 0);
+}
+
+/* Return an empty coloring for the given line, to be filled in with the pieces
+ * found up to the given index.  When the maximum number of colorings has been
+ * reached, the one of the least recently drawn line gets reused. */
+painttype *fresh_paint_for(linestruct *line, size_t reach)
+{
+	painttype *paint = painting_of(line);
+
+	if (paint) {
+		unchain_paint(paint);
+		unhash_paint(paint);
+	} else if (paintings == MAX_PAINTED) {
+		paint = oldest_paint;
+		unchain_paint(paint);
+		unhash_paint(paint);
+	} else {
+		paint = nmalloc(sizeof(painttype));
+		paint->syntax = NULL;
+		paint->context = NULL;
+		paint->spans = NULL;
+		paint->room = 0;
+		paintings++;
+	}
+
+	/* A different syntax may have a different number of multiline rules. */
+	if (paint->syntax != openfile->syntax)
+		paint->context = nrealloc(paint->context,
+						(openfile->syntax->multiscore + 1) * sizeof(short));
+
+	for (short id = 0; id < openfile->syntax->multiscore; id++)
+		paint->context[id] = info_before(line, id);
+
+	paint->line = line;
+	paint->syntax = openfile->syntax;
+	paint->reach = reach;
+	paint->count = 0;
+
+	paint->sibling = *slot_of(line);
+	*slot_of(line) = paint;
+	chain_paint(paint);
+
+	return paint;
+}
+
+/* Append a piece with the given extent and attributes to the given coloring. */
+void add_span(painttype *paint, size_t start, size_t end, int attributes)
+{
+	if (paint->count == paint->room) {
+		paint->room = 2 * paint->room + 8;
+		paint->spans = nrealloc(paint->spans, paint->room * sizeof(spantype));
+	}
+
+	paint->spans[paint->count].start = start;
+	paint->spans[paint->count].end = end;
+	paint->spans[paint->count].attributes = attributes;
+	paint->count++;
+}
+
+/* Discard the remembered coloring of the given line, if any. */
+void forget_the_paint(linestruct *line)
+{
+	painttype *paint = (paintings > 0) ? painting_of(line) : NULL;
+
+	if (paint == NULL)
+		return;
+
+	unchain_paint(paint);
+	unhash_paint(paint);
+	free(paint->context);
+	free(paint->spans);
+	free(paint);
+
+	paintings--;
+}
+
 #endif /* ENABLE_COLOR */
@@ -33,14 +33,14 @@ void expunge(undo_type action)
 	/* When in the middle of a line, delete the current character. */
 	if (openfile->current->data[openfile->current_x]) {
 		int charlen = char_length(openfile->current->data + openfile->current_x);
-		size_t line_len = strlen(openfile->current->data + openfile->current_x);
+		size_t line_len = openfile->current->length - openfile->current_x;
 #ifndef NANO_TINY
 		size_t old_amount = ISSET(SOFTWRAP) ? extra_chunks_in(openfile->current) : 0;
 
 		/* If the type of action changed or the cursor moved to a different
 		 * line, create a new undo item, otherwise update the existing item. */
 		if (action != openfile->last_action ||
-					openfile->current->lineno != openfile->current_undo->head_lineno)
+					lineno_of(openfile->current) != openfile->current_undo->head_lineno)
 			add_undo(action, NULL);
 		else
 			update_undo(action);
@@ -49,6 +49,20 @@ void expunge(undo_type action)
 		memmove(&openfile->current->data[openfile->current_x],
 					&openfile->current->data[openfile->current_x + charlen],
 					line_len - charlen + 1);
+
+		/* On a plain line the metrics can be adjusted; otherwise recount. */
+		if (openfile->current->plain) {
+			openfile->current->length--;
+			openfile->current->chars--;
+#ifdef ENABLE_COLOR
+			mark_as_stale(openfile->current);
+			forget_the_paint(openfile->current);
+#endif
+#ifndef NANO_TINY
+			openfile->current->hits = UNCOUNTED;
+#endif
+		} else
+			remeasure(openfile->current);
 #ifndef NANO_TINY
 		/* When softwrapping, a changed number of chunks requires a refresh. */
 		if (ISSET(SOFTWRAP) && extra_chunks_in(openfile->current) != old_amount)
@@ -86,9 +100,10 @@ void expunge(undo_type action)
 		openfile->current->has_anchor |= joining->has_anchor;
 #endif
 		/* Add the content of the next line to that of the current one. */
-		openfile->current->data = nrealloc(openfile->current->data,
-				strlen(openfile->current->data) + strlen(joining->data) + 1);
-		strcat(openfile->current->data, joining->data);
+		openfile->current->data = realloc_text(openfile->current->data,
+				openfile->current->length + joining->length + 1);
+		strcpy(openfile->current->data + openfile->current->length, joining->data);
+		remeasure(openfile->current);
 
 		unlink_node(joining);
 
@@ -202,13 +217,13 @@ void chop_word(bool forward)
 				openfile->current = was_current;
 				openfile->current_x = 0;
 			} else
-				openfile->current_x = strlen(openfile->current->data);
+				openfile->current_x = openfile->current->length;
 		}
 	} else {
 		do_next_word(ISSET(AFTER_ENDS));
 		if (openfile->current != was_current && was_current->data[was_x]) {
 			openfile->current = was_current;
-			openfile->current_x = strlen(was_current->data);
+			openfile->current_x = was_current->length;
 		}
 	}
 
@@ -253,11 +268,11 @@ void chop_next_word(void)
 void extract_segment(linestruct *top, size_t top_x, linestruct *bot, size_t bot_x)
 {
 	linestruct *taken, *last;
-	bool edittop_inside = (openfile->edittop->lineno >= top->lineno &&
-							openfile->edittop->lineno <= bot->lineno);
+	bool edittop_inside = (lineno_of(openfile->edittop) >= lineno_of(top) &&
+							lineno_of(openfile->edittop) <= lineno_of(bot));
 #ifndef NANO_TINY
 	bool same_line = (openfile->mark == top);
-	bool post_marked = (openfile->mark && (openfile->mark->lineno > top->lineno ||
+	bool post_marked = (openfile->mark && (lineno_of(openfile->mark) > lineno_of(top) ||
 						(same_line && openfile->mark_x > top_x)));
 	static bool inherited_anchor = FALSE;
 	bool had_anchor = top->has_anchor;
@@ -268,12 +283,23 @@ void extract_segment(linestruct *top, size_t top_x, linestruct *bot, size_t bot_
 	if (top != bot)
 		for (linestruct *line = top->next; line != bot->next; line = line->next)
 			had_anchor |= line->has_anchor;
+
+	/* When lines leave the buffer, the line that stays takes their places
+	 * in the index of lines. */
+	if (top != bot && openfile->signposts) {
+		if (top_x == 0 && bot_x == 0)
+			reroute_signposts(lineno_of(top), lineno_of(bot) - 1, bot);
+		else
+			reroute_signposts(lineno_of(top) + 1, lineno_of(bot), top);
+	}
 #endif
 
 	if (top == bot) {
 		taken = make_new_node(NULL);
 		taken->data = measured_copy(top->data + top_x, bot_x - top_x);
-		memmove(top->data + top_x, top->data + bot_x, strlen(top->data + bot_x) + 1);
+		remeasure(taken);
+		memmove(top->data + top_x, top->data + bot_x, top->length - bot_x + 1);
+		remeasure(top);
 		last = taken;
 	} else if (top_x == 0 && bot_x == 0) {
 		taken = top;
@@ -287,6 +313,9 @@ void extract_segment(linestruct *top, size_t top_x, linestruct *bot, size_t bot_
 		last->next = NULL;
 
 		bot->prev = top->prev;
+#ifdef ENABLE_COLOR
+		mark_as_stale(bot);
+#endif
 		if (top->prev)
 			top->prev->next = bot;
 		else
@@ -296,6 +325,7 @@ void extract_segment(linestruct *top, size_t top_x, linestruct *bot, size_t bot_
 	} else {
 		taken = make_new_node(NULL);
 		taken->data = copy_of(top->data + top_x);
+		remeasure(taken);
 		taken->next = top->next;
 		top->next->prev = taken;
 
@@ -303,11 +333,13 @@ void extract_segment(linestruct *top, size_t top_x, linestruct *bot, size_t bot_
 		if (bot->next)
 			bot->next->prev = top;
 
-		top->data = nrealloc(top->data, top_x + strlen(bot->data + bot_x) + 1);
+		top->data = realloc_text(top->data, top_x + bot->length - bot_x + 1);
 		strcpy(top->data + top_x, bot->data + bot_x);
+		remeasure(top);
 
 		last = bot;
 		last->data[bot_x] = '\0';
+		remeasure(last);
 		last->next = NULL;
 
 		openfile->current = top;
@@ -325,9 +357,10 @@ void extract_segment(linestruct *top, size_t top_x, linestruct *bot, size_t bot_
 		inherited_anchor = taken->has_anchor;
 #endif
 	} else {
-		cutbottom->data = nrealloc(cutbottom->data,
-							strlen(cutbottom->data) + strlen(taken->data) + 1);
-		strcat(cutbottom->data, taken->data);
+		cutbottom->data = realloc_text(cutbottom->data,
+							cutbottom->length + taken->length + 1);
+		strcpy(cutbottom->data + cutbottom->length, taken->data);
+		remeasure(cutbottom);
 #ifndef NANO_TINY
 		cutbottom->has_anchor = taken->has_anchor && !inherited_anchor;
 		inherited_anchor |= taken->has_anchor;
@@ -372,8 +405,8 @@ void extract_segment(linestruct *top, size_t top_x, linestruct *bot, size_t bot_
 void ingraft_buffer(linestruct *topline)
 {
 	linestruct *line = openfile->current;
-	size_t length = strlen(line->data);
-	size_t extralen = strlen(topline->data);
+	size_t length = line->length;
+	size_t extralen = topline->length;
 	size_t xpos = openfile->current_x;
 	char *tailtext = copy_of(line->data + xpos);
 #ifndef NANO_TINY
@@ -381,8 +414,13 @@ void ingraft_buffer(linestruct *topline)
 #endif
 	linestruct *botline = topline;
 
-	while (botline->next)
+	while (botline->next) {
 		botline = botline->next;
+#ifndef NANO_TINY
+		/* Consider the grafted lines as new, so that they get numbered. */
+		botline->stamp = 0;
+#endif
+	}
 
 	/* Add the size of the text to be grafted to the buffer size. */
 	openfile->totsize += number_of_characters_in(topline, botline);
@@ -392,7 +430,7 @@ void ingraft_buffer(linestruct *topline)
 
 	if (extralen > 0) {
 		/* Insert the text of topline at the current cursor position. */
-		line->data = nrealloc(line->data, length + extralen + 1);
+		line->data = realloc_text(line->data, length + extralen + 1);
 		memmove(line->data + xpos + extralen, line->data + xpos, length - xpos + 1);
 		strncpy(line->data + xpos, topline->data, extralen);
 	}
@@ -403,6 +441,7 @@ void ingraft_buffer(linestruct *topline)
 			openfile->filebot = botline;
 
 		line->data[xpos + extralen] = '\0';
+		remeasure(line);
 
 		/* Hook the grafted lines in after the current one. */
 		botline->next = openfile->current->next;
@@ -412,16 +451,19 @@ void ingraft_buffer(linestruct *topline)
 		topline->next->prev = openfile->current;
 
 		/* Add the text after the cursor position at the end of botline. */
-		length = strlen(botline->data);
+		length = botline->length;
 		extralen = strlen(tailtext);
-		botline->data = nrealloc(botline->data, length + extralen + 1);
+		botline->data = realloc_text(botline->data, length + extralen + 1);
 		strcpy(botline->data + length, tailtext);
+		remeasure(botline);
 
 		/* Put the cursor at the end of the grafted text. */
 		openfile->current = botline;
 		openfile->current_x = length;
-	} else
+	} else {
+		remeasure(line);
 		openfile->current_x += extralen;
+	}
 
 #ifndef NANO_TINY
 	/* When needed, update the mark's pointer and position. */
@@ -446,14 +488,14 @@ void ingraft_buffer(linestruct *topline)
 void copy_from_buffer(linestruct *somebuffer)
 {
 #ifdef ENABLE_COLOR
-	size_t threshold = openfile->edittop->lineno + editwinrows - 1;
+	size_t threshold = lineno_of(openfile->edittop) + editwinrows - 1;
 #endif
 	linestruct *the_copy = copy_buffer(somebuffer);
 
 	ingraft_buffer(the_copy);
 
 #ifdef ENABLE_COLOR
-	if (openfile->current->lineno > threshold || ISSET(SOFTWRAP))
+	if (lineno_of(openfile->current) > threshold || ISSET(SOFTWRAP))
 		recook = TRUE;
 	else
 		perturbed = TRUE;
@@ -497,7 +539,7 @@ void do_snip(bool marked, bool until_eof, bool append)
 	/* Now move the relevant piece of text into the cutbuffer. */
 	if (until_eof)
 		extract_segment(openfile->current, openfile->current_x,
-		                openfile->filebot, strlen(openfile->filebot->data));
+		                openfile->filebot, openfile->filebot->length);
 	else if (openfile->mark) {
 		cut_marked_region();
 		openfile->mark = NULL;
@@ -506,7 +548,7 @@ void do_snip(bool marked, bool until_eof, bool append)
 		 * the cutbuffer.  Otherwise, when not at the end of the buffer,
 		 * move just the "line separator" into the cutbuffer. */
 		if (line->data[openfile->current_x])
-			extract_segment(line, openfile->current_x, line, strlen(line->data));
+			extract_segment(line, openfile->current_x, line, line->length);
 		else if (openfile->current != openfile->filebot) {
 			extract_segment(line, openfile->current_x, line->next, 0);
 			openfile->placewewant = xplustabs();
@@ -519,7 +561,7 @@ void do_snip(bool marked, bool until_eof, bool append)
 		if (openfile->current != openfile->filebot)
 			extract_segment(line, 0, line->next, 0);
 		else
-			extract_segment(line, 0, line, strlen(line->data));
+			extract_segment(line, 0, line, line->length);
 
 		openfile->placewewant = 0;
 	}
@@ -608,7 +650,7 @@ void copy_marked_region(void)
 {
 	linestruct *topline, *botline, *afterline;
 	char *was_datastart, saved_byte;
-	size_t top_x, bot_x;
+	size_t top_x, bot_x, top_length, bot_length;
 
 	get_region(&topline, &top_x, &botline, &bot_x);
 
@@ -626,15 +668,21 @@ void copy_marked_region(void)
 	afterline = botline->next;
 	botline->next = NULL;
 	saved_byte = botline->data[bot_x];
+	top_length = topline->length;
+	bot_length = botline->length;
 	botline->data[bot_x] = '\0';
+	botline->length = bot_x;
 	was_datastart = topline->data;
 	topline->data += top_x;
+	topline->length -= top_x;
 
 	cutbuffer = copy_buffer(topline);
 
 	/* Restore the proper state of the buffer. */
 	topline->data = was_datastart;
+	topline->length = top_length;
 	botline->data[bot_x] = saved_byte;
+	botline->length = bot_length;
 	botline->next = afterline;
 }
 #endif /* !NANO_TINY */
@@ -678,6 +726,7 @@ void copy_text(void)
 
 	addition = make_new_node(NULL);
 	addition->data = copy_of(openfile->current->data + from_x);
+	remeasure(addition);
 
 	if (ISSET(CUT_FROM_CURSOR))
 		sans_newline = !at_eol;
@@ -713,7 +762,7 @@ void copy_text(void)
 		openfile->current = openfile->current->next;
 		openfile->current_x = 0;
 	} else
-		openfile->current_x = strlen(openfile->current->data);
+		openfile->current_x = openfile->current->length;
 
 	edit_redraw(was_current, FLOWING);
 
@@ -733,7 +782,7 @@ void paste_text(void)
 #ifndef NANO_TINY
 	bool had_anchor = was_current->has_anchor;
 #endif
-	ssize_t was_lineno = openfile->current->lineno;
+	ssize_t was_lineno = lineno_of(openfile->current);
 	size_t was_leftedge = 0;
 
 	if (cutbuffer == NULL) {
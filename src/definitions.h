@@ -64,6 +64,7 @@
 #include <signal.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <time.h>
 
 #ifdef HAVE_NCURSES_H
 #include <ncurses.h>
@@ -149,6 +150,45 @@
 /* The default comment character when a syntax does not specify any. */
 #define GENERAL_COMMENT_CHARACTER  "#"
 
+#ifndef NANO_TINY
+/* The size from which a file in view mode is not read in all at once. */
+#define HUGE_FILE_SIZE  (256 * 1024 * 1024)
+/* The size from which a file is read in progressively (only its start at
+ * first, the rest while the user is idle), and the sizes of the portions. */
+#define PROGRESSIVE_SIZE  (8 * 1024 * 1024)
+#define FIRST_PORTION  (256 * 1024)
+#define LOADING_SLICE  (1024 * 1024)
+/* The amount of text that is searched in one go when counting the matches
+ * of a search, and the number of seconds after which the counting gives up. */
+#define COUNTING_SLICE  (1024 * 1024)
+#define COUNTING_PATIENCE  10
+/* The match count of a line whose matches have not been counted yet, and
+ * the count of a line with too many matches to store. */
+#define UNCOUNTED  0xFFFF
+#define MANY_MATCHES  0xFFFE
+/* The number of renumberings that are remembered before all lines get
+ * numbered afresh, and the distance between lines in the index of lines. */
+#define MAX_SHIFTS  512
+#define SIGNPOST_GAP  256
+/* The size of a slab from which line nodes are taken (also its alignment),
+ * and the number of nodes that fit into it. */
+#define SLAB_SIZE  (64 * 1024)
+#define SLAB_NODES  ((SLAB_SIZE - sizeof(slabstruct)) / sizeof(linestruct))
+/* The allocation granularity of Windows, in which blocks of text are made. */
+#define GRAIN_SIZE  (64 * 1024)
+/* The room inside a line node for a short text plus its terminating NUL
+ * (it fills out the node to 64 bytes). */
+#define TINY_ROOM  5
+#endif
+
+#ifdef ENABLE_COLOR
+/* The number of multiline-regex infos that fit in the place of a pointer. */
+#define MULTIBOX  (sizeof(size_t) / sizeof(short))
+/* Whether the given line has multiline-regex info, and where this info is. */
+#define HAS_MULTIDATA(line)  ((line)->boxed || (line)->multidata != NULL)
+#define MULTIDATA(line)  ((line)->boxed ? (line)->multibox : (line)->multidata)
+#endif
+
 /* The maximum number of search/replace history strings saved. */
 #define MAX_SEARCH_HISTORY  100
 
@@ -170,6 +210,14 @@
 		/* The start regex matches on an earlier line, the end regex on this one. */
 #define JUSTONTHIS   (1<<5)
 		/* Both the start and end regexes match within this line. */
+
+/* The end of a colored piece that extends to the end of the line. */
+#define TO_THE_END  (~(size_t)0)
+
+/* The most strings that a set of literals may hold. */
+#define MAX_WORDS  64
+/* The longest that a literal may grow. */
+#define MAX_WORD_LEN  24
 #endif
 
 /* Basic control codes. */
@@ -302,7 +350,7 @@ typedef enum {
 #ifdef ENABLE_WRAPPING
 	SPLIT_BEGIN, SPLIT_END,
 #endif
-	INDENT, UNINDENT,
+	INDENT, UNINDENT, REPLACE_ALL,
 #ifdef ENABLE_COMMENT
 	COMMENT, UNCOMMENT, PREFLIGHT,
 #endif
@@ -380,7 +428,10 @@ enum {
 	MINIBAR,
 	ZERO,
 	MODERN_BINDINGS,
-	SOLO_SIDESCROLL
+	SOLO_SIDESCROLL,
+	ATOMIC_SAVE,
+	FOLLOW_MODE,
+	INCREMENTAL_SEARCH
 };
 
 /* Structure types. */
@@ -400,10 +451,45 @@ typedef struct colortype {
 		/* The compiled regular expression for 'start=', or the only one. */
 	regex_t *end;
 		/* The compiled regular expression for 'end=', if any. */
+	char *literals;
+		/* The strings of which a match of the (start) regex must contain
+		 * at least one, each terminated by a NUL; NULL when not known. */
+	char *endliterals;
+		/* The same for the 'end=' regex, if any. */
+	short clue;
+		/* The number of the literals in the sieve for this kind of rule, or -1. */
+	short endclue;
+		/* The number of the literals of the 'end=' regex in its sieve, or -1. */
 	struct colortype *next;
 		/* Next color combination. */
 } colortype;
 
+typedef struct wordset {
+	char *word[MAX_WORDS];
+		/* The strings, folded to lowercase. */
+	int count;
+		/* The number of strings in the set. */
+} wordset;
+
+typedef struct sievetype {
+	unsigned char kind[256];
+		/* The class of each byte; bytes that occur in no literal are class 0. */
+	int kinds;
+		/* The number of byte classes. */
+	unsigned short *jump;
+		/* For each state and byte class, the state to go to. */
+	int *from;
+		/* For each state, where its list of recognized clues starts. */
+	int *upto;
+		/* For each state, where its list of recognized clues ends. */
+	short *clues;
+		/* The lists of clues (numbers of sets) that each state recognizes. */
+	short count;
+		/* The number of sets of literals. */
+	bool *found;
+		/* For each of those sets, whether one of its literals was seen. */
+} sievetype;
+
 typedef struct regexlisttype {
 	regex_t *one_rgx;
 		/* A regex to match things that imply a certain syntax. */
@@ -451,10 +537,46 @@ typedef struct syntaxtype {
 		/* The colors and their regexes used in this syntax. */
 	short multiscore;
 		/* How many multiline regex strings this syntax has. */
+	sievetype *sieve;
+		/* The automaton that looks for the literals of all single-line rules at once. */
+	sievetype *multisieve;
+		/* The same for the literals of the start and end regexes of multiline rules. */
 	struct syntaxtype *next;
 		/* Next syntax. */
 } syntaxtype;
 
+typedef struct spantype {
+	size_t start;
+		/* The byte index in the line where the colored piece begins. */
+	size_t end;
+		/* Where the piece ends, or TO_THE_END when it runs through the line. */
+	int attributes;
+		/* The attributes with which to paint the piece. */
+} spantype;
+
+typedef struct painttype {
+	struct linestruct *line;
+		/* The line whose coloring this is. */
+	const syntaxtype *syntax;
+		/* The syntax with which the coloring was determined. */
+	short *context;
+		/* The multidata of the preceding line at that moment. */
+	size_t reach;
+		/* The index up to which the single-line rules were looked at. */
+	spantype *spans;
+		/* The colored pieces, in the order in which to paint them. */
+	size_t count;
+		/* The number of colored pieces. */
+	size_t room;
+		/* The number of pieces for which there is space. */
+	struct painttype *newer;
+		/* The coloring of the line that was drawn next after this one. */
+	struct painttype *older;
+		/* The coloring of the line that was drawn just before this one. */
+	struct painttype *sibling;
+		/* The next coloring whose line hashes to the same slot. */
+} painttype;
+
 typedef struct lintstruct {
 	ssize_t lineno;
 		/* Line number of the error. */
@@ -475,6 +597,8 @@ typedef struct lintstruct {
 typedef struct linestruct {
 	char *data;
 		/* The text of this line. */
+	size_t length;
+		/* The number of bytes in this text, so that strlen() is not needed. */
 	ssize_t lineno;
 		/* The number of this line. */
 	struct linestruct *next;
@@ -482,12 +606,38 @@ typedef struct linestruct {
 	struct linestruct *prev;
 		/* Previous node. */
 #ifdef ENABLE_COLOR
-	short *multidata;
-		/* Array of which multi-line regexes apply to this line. */
-#endif
+	union {
+		short *multidata;
+			/* Array of which multi-line regexes apply to this line. */
+		short multibox[MULTIBOX];
+			/* The same array, inside the node, when it is small enough. */
+	};
+#endif
+	unsigned int chars;
+		/* The number of characters in this text.  (It is only used for
+		 * the character count of the buffer, so 32 bits will do.) */
 #ifndef NANO_TINY
-	bool has_anchor;
+	unsigned int stamp;
+		/* The numbering generation for which lineno was last made right;
+		 * zero when the line is new and has not been numbered yet. */
+	unsigned short hits;
+		/* The number of matches of the last search in this line. */
+	bool has_anchor : 1;
 		/* Whether the user has placed an anchor at this line. */
+	bool signpost : 1;
+		/* Whether this line is in the index of lines of the buffer. */
+#endif
+	bool plain : 1;
+		/* Whether the text is only printable ASCII, one column per byte. */
+#ifdef ENABLE_COLOR
+	bool stale : 1;
+		/* Whether the multidata of this line may no longer be right. */
+	bool boxed : 1;
+		/* Whether the multidata of this line lies in multibox. */
+#endif
+#ifndef NANO_TINY
+	char tiny[TINY_ROOM];
+		/* Room for a short text, so that it needs no allocation of its own. */
 #endif
 } linestruct;
 
@@ -529,6 +679,64 @@ typedef struct undostruct {
 	struct undostruct *next;
 		/* A pointer to the undo item of the preceding action. */
 } undostruct;
+
+typedef struct hugestruct {
+	FILE *stream;
+		/* The open file from which lines are fetched when needed. */
+	off_t *milestones;
+		/* The offsets of lines 1, 1 + STRIDE, 1 + 2 * STRIDE, and so on. */
+	size_t known;
+		/* The number of milestones that have been found so far. */
+	size_t room;
+		/* The number of milestones for which space was allocated. */
+	off_t scanned;
+		/* The offset of the first line that has not been scanned past. */
+	ssize_t scanned_lineno;
+		/* The number of that line. */
+	ssize_t lastline;
+		/* The number of the last line of the file; zero while unknown. */
+	bool reached_end;
+		/* Whether the last line of the file is in the window. */
+	linestruct *batch;
+		/* Lines outside of the window that were fetched for a search. */
+	off_t batch_beyond;
+		/* The offset of the line that follows the batch. */
+	ssize_t batch_next;
+		/* The number of that line. */
+} hugestruct;
+
+typedef struct blockstruct {
+	char *start;
+		/* The memory into which a file was read in whole. */
+	size_t size;
+		/* The number of bytes in this memory. */
+	size_t users;
+		/* The number of lines whose text still lies in this memory. */
+} blockstruct;
+
+typedef struct grainstruct {
+	uintptr_t grain;
+		/* The number of a grain of memory (its address divided by its size). */
+	blockstruct *block;
+		/* The block that this grain belongs to; NULL when the slot is free. */
+} grainstruct;
+
+typedef struct slabstruct {
+	struct openfilestruct *owner;
+		/* The buffer for which this slab was made; NULL when none. */
+	struct slabstruct *next;
+		/* Next slab in the circular list of the same buffer. */
+	struct slabstruct *prev;
+		/* Previous slab in the circular list of the same buffer. */
+	linestruct *freed;
+		/* The nodes in this slab that were given back, chained via next. */
+	size_t used;
+		/* The number of nodes that were handed out from the untouched part. */
+	size_t live;
+		/* The number of nodes in this slab that are currently in use. */
+	linestruct nodes[];
+		/* The nodes themselves. */
+} slabstruct;
 #endif /* !NANO_TINY */
 
 #ifdef ENABLE_HISTORIES
@@ -595,12 +803,53 @@ typedef struct openfilestruct {
 		/* The undo item at which the file was last saved. */
 	undo_type last_action;
 		/* The type of the last action the user performed. */
+	hugestruct *hugefile;
+		/* When viewing a huge file: what is needed to fetch its lines. */
+	off_t followed;
+		/* How many bytes of the file have been read into the buffer. */
+	bool loading;
+		/* Whether the file is still being read into the buffer. */
+	int feed;
+		/* The pipe through which more text for the buffer arrives, or -1. */
+	char *leftover;
+		/* An incomplete line that was read from this pipe. */
+	size_t leftlen;
+		/* The length of this incomplete line. */
+	unsigned int generation;
+		/* The current numbering generation of the lines in the buffer. */
+	unsigned int settled;
+		/* The generation when lines were last numbered afresh; a line with
+		 * an older stamp was right then, and is subject to all later shifts. */
+	size_t shiftcount;
+		/* The number of renumberings since all lines were last numbered. */
+	ssize_t *shiftfrom;
+		/* For each of these renumberings, the first old number that shifted, */
+	ssize_t *shiftby;
+		/* and by how much that number and all higher numbers shifted. */
+	linestruct **signposts;
+		/* Every SIGNPOST_GAP-th line, for quickly finding a line by number. */
+	size_t signcount;
+		/* The number of lines in the above index. */
+	slabstruct *slabs;
+		/* The slabs from which the nodes of this buffer are taken. */
+	size_t allocations;
+		/* The number of nodes that were taken from these slabs. */
+	size_t slabbytes;
+		/* The amount of memory that these slabs currently occupy, */
+	size_t peakbytes;
+		/* and the highest amount that they have occupied. */
 #endif
 	bool modified;
 		/* Whether the file has been modified. */
 #ifdef ENABLE_COLOR
 	syntaxtype *syntax;
 		/* The syntax that applies to this file, if any. */
+#ifndef NANO_TINY
+	ssize_t stale_from;
+		/* The number of the first line whose multiline info may be wrong, */
+	ssize_t stale_upto;
+		/* and of the last such line; when the first is beyond the last, none. */
+#endif
 #endif
 #ifdef ENABLE_MULTIBUFFER
 	char *errormessage;
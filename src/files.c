@@ -29,6 +29,7 @@
 #endif
 #include <string.h>
 #include <unistd.h>
+#include <io.h>
 #define WIN32_LEAN_AND_MEAN 1
 #include <windows.h>
 #include <shlobj.h>
@@ -69,6 +70,13 @@ void make_new_buffer(void)
 
 	openfile->filename = copy_of("");
 
+#ifndef NANO_TINY
+	/* The nodes of this buffer will be taken from its own slabs. */
+	openfile->slabs = NULL;
+	openfile->allocations = 0;
+	openfile->slabbytes = 0;
+	openfile->peakbytes = 0;
+#endif
 	openfile->filetop = make_new_node(NULL);
 	openfile->filetop->data = copy_of("");
 	openfile->filebot = openfile->filetop;
@@ -100,12 +108,32 @@ void make_new_buffer(void)
 
 	openfile->statinfo = NULL;
 	openfile->lock_filename = NULL;
+
+	openfile->hugefile = NULL;
+	openfile->followed = 0;
+	openfile->loading = FALSE;
+	openfile->feed = -1;
+	openfile->leftover = NULL;
+	openfile->leftlen = 0;
+
+	openfile->generation = 1;
+	openfile->settled = 1;
+	openfile->shiftcount = 0;
+	openfile->shiftfrom = NULL;
+	openfile->shiftby = NULL;
+	openfile->signposts = NULL;
+	openfile->signcount = 0;
+	openfile->filetop->stamp = openfile->generation;
 #endif
 #ifdef ENABLE_MULTIBUFFER
 	openfile->errormessage = NULL;
 #endif
 #ifdef ENABLE_COLOR
 	openfile->syntax = NULL;
+#ifndef NANO_TINY
+	openfile->stale_from = HIGHEST_POSITIVE;
+	openfile->stale_upto = 0;
+#endif
 #endif
 }
 
@@ -451,11 +479,18 @@ bool open_buffer(const char *filename, bool new_one)
 	if (*filename && !ISSET(NOREAD_MODE))
 		descriptor = open_file(realname, new_one, &f);
 
-	/* If we've successfully opened an existing file, read it in. */
+	/* If we've successfully opened an existing file, read it in -- except
+	 * when it is a huge file that is only going to be viewed. */
 	if (descriptor > 0) {
 		install_handler_for_Ctrl_C();
 
-		read_file(f, descriptor, realname, !new_one);
+#ifndef NANO_TINY
+		if (new_one && ISSET(VIEW_MODE) && S_ISREG(fileinfo.st_mode) &&
+										fileinfo.st_size >= HUGE_FILE_SIZE)
+			open_hugefile(f);
+		else
+#endif
+			read_file(f, descriptor, realname, !new_one);
 
 		restore_handler_for_Ctrl_C();
 
@@ -508,7 +543,7 @@ void prepare_for_display(void)
 
 #ifdef ENABLE_COLOR
 	/* Precalculate the data for any multiline coloring regexes. */
-	if (!openfile->filetop->multidata)
+	if (!HAS_MULTIDATA(openfile->filetop))
 		precalc_multicolorinfo();
 	have_palette = FALSE;
 #endif
@@ -519,7 +554,7 @@ void prepare_for_display(void)
 /* Show name of current buffer and its number of lines on the status bar. */
 void mention_name_and_linecount(void)
 {
-	size_t count = openfile->filebot->lineno - (openfile->filebot->data[0] == '\0' ? 1 : 0);
+	size_t count = lineno_of(openfile->filebot) - (openfile->filebot->data[0] == '\0' ? 1 : 0);
 
 #ifndef NANO_TINY
 	if (ISSET(MINIBAR)) {
@@ -528,6 +563,12 @@ void mention_name_and_linecount(void)
 	} else if (ISSET(ZERO))
 		return;
 
+	/* While the file is still being read, its number of lines is unknown. */
+	if (openfile->loading) {
+		statusline(HUSH, "%s -- %s", tail(openfile->filename), _("Loading..."));
+		return;
+	}
+
 	if (openfile->fmt > NIX_FILE)
 		/* TRANSLATORS: First %s is file name, second %s is file format. */
 		statusline(HUSH, P_("%s -- %zu line (%s)", "%s -- %zu lines (%s)", count),
@@ -600,12 +641,28 @@ void close_buffer(void)
 	orphan->next->prev = orphan->prev;
 
 	free(orphan->filename);
-	free_lines(orphan->filetop);
+	free_buffer_lines(orphan->filetop);
 #ifndef NANO_TINY
+	free(orphan->shiftfrom);
+	free(orphan->shiftby);
 	free(orphan->statinfo);
 	free(orphan->lock_filename);
 	/* Free the undo stack. */
 	discard_until(NULL);
+
+	if (orphan->hugefile) {
+		fclose(orphan->hugefile->stream);
+		free_buffer_lines(orphan->hugefile->batch);
+		free(orphan->hugefile->milestones);
+		free(orphan->hugefile);
+	}
+
+	if (orphan->feed >= 0)
+		close(orphan->feed);
+	free(orphan->leftover);
+
+	/* Slabs that still hold nodes (of the cutbuffer) must outlive the buffer. */
+	disown_slabs();
 #endif
 	free(orphan->errormessage);
 
@@ -621,49 +678,62 @@ void close_buffer(void)
 }
 #endif /* ENABLE_MULTIBUFFER */
 
-/* Encode any NUL bytes in the given line of text (of the given length),
- * and return a dynamically allocated copy of the resultant string. */
-char *encode_data(char *text, size_t length)
+/* Give the given line a copy of the given text (of the given length), with
+ * any NUL bytes in it encoded.  A short text is stored inside the node. */
+void encode_data(linestruct *line, const char *text, size_t length)
 {
-	recode_NUL_to_LF(text, length);
-	text[length] = '\0';
+	char *copy = room_for_text(line, length);
 
-	return copy_of(text);
+	memcpy(copy, text, length);
+	copy[length] = '\0';
+
+	/* Only a line that contains a NUL byte needs to be recoded. */
+	if (memchr(copy, '\0', length))
+		recode_NUL_to_LF(copy, length);
+
+	line->data = copy;
 }
 
-/* The number of bytes by which we expand the line buffer while reading. */
-#define LUMPSIZE  120
+/* The number of bytes that we try to read from a file in one go. */
+#define BLOCKSIZE  (128 * 1024)
 
 /* Read the given open file f into the current buffer.  filename should be
  * set to the name of the file.  undoable means that undo records should be
  * created and that the file does not need to be checked for writability. */
 void read_file(FILE *f, int fd, const char *filename, bool undoable)
 {
-	ssize_t was_lineno = openfile->current->lineno;
+	ssize_t was_lineno = lineno_of(openfile->current);
 		/* The line number where we start the insertion. */
 	size_t was_leftedge = 0;
 		/* The leftedge where we start the insertion. */
 	size_t num_lines = 0;
 		/* The number of lines in the file. */
+	char *block = nmalloc(BLOCKSIZE);
+		/* The buffer into which we read a large chunk of the file. */
+	ssize_t got;
+		/* The number of bytes that the last read() delivered. */
 	size_t len = 0;
-		/* The length of the current line of the file. */
-	size_t bufsize = LUMPSIZE;
-		/* The size of the line buffer; increased as needed. */
-	char *buf = nmalloc(bufsize);
-		/* The buffer in which we assemble each line of the file. */
+		/* The length of the partial line that straddles two blocks. */
+	size_t bufsize = 0;
+		/* The size of the straddle buffer; increased as needed. */
+	char *buf = NULL;
+		/* The buffer in which we assemble a line that straddles blocks. */
 	linestruct *topline;
 		/* The top of the new buffer where we store the read file. */
 	linestruct *bottomline;
 		/* The bottom of the new buffer. */
-	int onevalue;
-		/* The current value we read from the file, either a byte or EOF. */
-	int errornumber;
+	int errornumber = 0;
 		/* The error code, in case an error occurred during reading. */
 	bool writable = TRUE;
 		/* Whether the file is writable (in case we care). */
 #ifndef NANO_TINY
 	format_type format = NIX_FILE;
 		/* The type of line ending the file uses: Unix or DOS. */
+	blockstruct *store = NULL;
+		/* The block of memory into which a regular file is read in whole. */
+	bool partial = FALSE;
+		/* Whether only the first portion of a large file gets read here. */
+	struct stat fileinfo;
 
 	if (undoable)
 		add_undo(INSERT, NULL);
@@ -680,69 +750,155 @@ void read_file(FILE *f, int fd, const char *filename, bool undoable)
 	block_sigwinch(TRUE);
 #endif
 
-#ifdef HAVE_FLOCKFILE
-	/* Lock the file before starting to read it, to avoid the overhead
-	 * of locking it for each single byte that we read from it. */
-	flockfile(f);
-#else
-# define getc_unlocked  getc
-#endif
-
 	control_C_was_pressed = FALSE;
 
-	/* Read in the entire file, byte by byte, line by line. */
-	while ((onevalue = getc_unlocked(f)) != EOF) {
-		char input = (char)onevalue;
+#ifndef NANO_TINY
+	/* When the file is a regular one, read it in whole into a single block of
+	 * memory, and let the lines point into this block instead of giving each
+	 * line its own copy.  A line gets its own copy only when it is edited. */
+	if (fstat(fileno(f), &fileinfo) == 0 && S_ISREG(fileinfo.st_mode) &&
+				fileinfo.st_size > 0 && (uintmax_t)fileinfo.st_size < SIZE_MAX) {
+		/* Of a large file that goes into a new buffer, read just the start,
+		 * so that it can be shown right away; the rest gets read in slices
+		 * while the user is idle, by catch_up_with_file().  Do the same for
+		 * any but the first of the files named on the command line, so that
+		 * the first one is shown without waiting for all the others. */
+		partial = (!undoable && (fileinfo.st_size > PROGRESSIVE_SIZE ||
+						(!we_are_running && openfile != startfile &&
+						fileinfo.st_size > FIRST_PORTION)));
+		store = new_text_block(partial ? FIRST_PORTION : fileinfo.st_size);
+	}
+
+	if (store) {
+		size_t filled = 0;
+		char *start = store->start, *newline;
 
-		if (control_C_was_pressed)
-			break;
+		while (filled < store->size && !control_C_was_pressed) {
+			got = read(fileno(f), store->start + filled, store->size - filled);
 
-		if (input == '\n') {
-#ifndef NANO_TINY
-			/* When automatic format conversion is not off, strip a CR before
-			 * a LF.  And set the format when this is the first line break. */
-			if (len > 0 && buf[len - 1] == '\r' && !ISSET(NO_CONVERT)) {
+			if (got < 0)
+				errornumber = errno;
+			if (got <= 0)
+				break;
+
+			filled += got;
+		}
+
+		while ((newline = memchr(start, '\n', store->start + filled - start))) {
+			size_t piece = newline - start;
+
+			if (piece > 0 && start[piece - 1] == '\r' && !ISSET(NO_CONVERT)) {
 				if (num_lines == 0)
 					format = DOS_FILE;
-				len--;
-			}
-#endif
-		} else {
-			/* Store the byte. */
-			buf[len] = input;
-
-			/* Keep track of the total length of the line.  It might have
-			 * NUL bytes in it, so we can't just use strlen() later. */
-			len++;
-
-			/* When needed, increase the line-buffer size.  Don't bother
-			 * decreasing it -- it gets freed when reading is finished. */
-			if (len == bufsize) {
-				bufsize += LUMPSIZE;
-				buf = nrealloc(buf, bufsize);
+				piece--;
 			}
 
-			continue;
+			/* Terminate the line in place, and recode any NULs in it. */
+			start[piece] = '\0';
+			if (memchr(start, '\0', piece))
+				recode_NUL_to_LF(start, piece);
+
+			bottomline->data = start;
+			remeasure(bottomline);
+			bottomline->next = make_new_node(bottomline);
+			bottomline = bottomline->next;
+			store->users++;
+			num_lines++;
+
+			start = newline + 1;
 		}
 
-		/* Store the data and make a new line. */
-		bottomline->data = encode_data(buf, len);
-		bottomline->next = make_new_node(bottomline);
-		bottomline = bottomline->next;
-		num_lines++;
+		/* When reading just the first portion, leave its incomplete last line
+		 * for later -- unless no line was complete or ^C was pressed. */
+		if (partial && num_lines > 0 && !control_C_was_pressed)
+			openfile->followed = start - store->start;
+		else
+			partial = FALSE;
+
+		/* Put a final piece without a newline into the straddle buffer, so that
+		 * it gets completed when the file has grown in the meantime. */
+		len = partial ? 0 : store->start + filled - start;
+		if (len > 0) {
+			bufsize = 2 * len;
+			buf = nmalloc(bufsize);
+			memcpy(buf, start, len);
+		}
 
-		/* Reset the length in preparation for the next line. */
-		len = 0;
+		if (store->users == 0)
+			release_text_block(store);
 	}
+#endif
+
+	/* Read in the entire file, a large block at a time, and split each block
+	 * into lines by searching for the newlines, instead of going byte by byte. */
+#ifndef NANO_TINY
+	if (!partial)
+#endif
+	while (errornumber == 0 && !control_C_was_pressed &&
+					(got = read(fileno(f), block, BLOCKSIZE)) != 0) {
+		char *start = block, *stop = block + got;
+
+		if (got < 0) {
+			errornumber = errno;
+			break;
+		}
+
+		while (start < stop) {
+			char *newline = memchr(start, '\n', stop - start);
+			size_t piece = (newline ? newline : stop) - start;
+			char *text = start;
+
+			/* When this is the tail or the middle of a line that started in an
+			 * earlier block, or the start of a line that continues in a later
+			 * block, collect the piece in the straddle buffer. */
+			if (len > 0 || newline == NULL) {
+				if (len + piece > bufsize) {
+					bufsize = 2 * (len + piece);
+					buf = nrealloc(buf, bufsize);
+				}
+				memcpy(buf + len, start, piece);
+				len += piece;
 
-	errornumber = errno;
+				if (newline == NULL)
+					break;
 
-#ifdef HAVE_FUNLOCKFILE
-	/* We are done with the file, unlock it. */
-	funlockfile(f);
+				text = buf;
+				piece = len;
+			}
+
+			start = newline + 1;
+			len = 0;
+
+#ifndef NANO_TINY
+			/* When automatic format conversion is not off, strip a CR before
+			 * a LF.  And set the format when this is the first line break. */
+			if (piece > 0 && text[piece - 1] == '\r' && !ISSET(NO_CONVERT)) {
+				if (num_lines == 0)
+					format = DOS_FILE;
+				piece--;
+			}
 #endif
+			/* Store the data and make a new line. */
+			encode_data(bottomline, text, piece);
+			remeasure(bottomline);
+			bottomline->next = make_new_node(bottomline);
+			bottomline = bottomline->next;
+			num_lines++;
+		}
+	}
+
+	free(block);
 
 #ifndef NANO_TINY
+	/* Remember how much of the file was read, for when following it. */
+	if (partial)
+		openfile->loading = TRUE;
+	else if (!undoable) {
+		off_t position = lseek(fileno(f), 0, SEEK_CUR);
+
+		openfile->followed = (position > 0) ? position : 0;
+	}
+
 	block_sigwinch(FALSE);
 
 	/* When reading from stdin, restore the terminal and reenter curses mode. */
@@ -755,7 +911,7 @@ void read_file(FILE *f, int fd, const char *filename, bool undoable)
 #endif
 
 	/* If there was a real error during the reading, let the user know. */
-	if (ferror(f) && errornumber != EINTR && errornumber != 0)
+	if (errornumber != EINTR && errornumber != 0)
 		statusline(ALERT, "%s", strerror(errornumber));
 
 	if (control_C_was_pressed)
@@ -771,15 +927,23 @@ void read_file(FILE *f, int fd, const char *filename, bool undoable)
 	if (len == 0)
 		bottomline->data = copy_of("");
 	else {
-		bottomline->data = encode_data(buf, len);
+		encode_data(bottomline, buf, len);
 		num_lines++;
 	}
 
+	remeasure(bottomline);
+
 	free(buf);
 
 	/* Insert the just read buffer into the current one. */
 	ingraft_buffer(topline);
 
+#ifndef NANO_TINY
+	/* When the buffer got all of its text, number and index its lines. */
+	if (!undoable && !partial)
+		index_the_lines();
+#endif
+
 	/* Set the desired x position at the end of what was inserted. */
 	openfile->placewewant = xplustabs();
 
@@ -788,6 +952,8 @@ void read_file(FILE *f, int fd, const char *filename, bool undoable)
 	else if ((ISSET(ZERO) || ISSET(MINIBAR)) && !(we_are_running && undoable))
 		;  /* No blurb for new buffers with --zero or --mini. */
 #ifndef NANO_TINY
+	else if (partial)
+		;  /* The line count gets reported when the loading is done. */
 	else if (format == DOS_FILE)
 		/* TRANSLATORS: Keep the next two messages at most 78 characters. */
 		statusline(REMARK, P_("Read %zu line (converted from DOS format)",
@@ -884,6 +1050,784 @@ int open_file(const char *filename, bool new_one, FILE **f)
 	return fd;
 }
 
+#ifndef NANO_TINY
+/* Add the given lines at the end of the current buffer, continuing its last
+ * line when continuing is TRUE.  When follow is TRUE, put the cursor at the
+ * end of the buffer.  Return TRUE when the added lines are on screen. */
+bool append_lines(linestruct *topline, linestruct *bottomline,
+						bool continuing, bool follow)
+{
+	linestruct *was_current = openfile->current;
+	size_t was_x = openfile->current_x;
+	linestruct *spot, *line;
+	bool visible = FALSE;
+
+	/* When nothing new remains, there is nothing to add. */
+	if (topline == bottomline && bottomline->length == 0) {
+		delete_node(topline);
+		return FALSE;
+	}
+
+	/* Add the new text at the end of the last line that was read before.
+	 * When this line is followed by the magic line, and the new text ends
+	 * with a newline, the magic line already represents this newline. */
+	spot = openfile->filebot;
+	if (continuing && !ISSET(NO_NEWLINES) && spot->prev) {
+		spot = spot->prev;
+
+		if (topline != bottomline && bottomline->length == 0) {
+			bottomline = bottomline->prev;
+			delete_node(bottomline->next);
+			bottomline->next = NULL;
+		}
+	}
+
+	/* Check whether the place where the text gets added is on screen. */
+	line = openfile->edittop;
+	for (int row = 0; row < editwinrows && line != NULL; row++, line = line->next)
+		if (line == spot || line == openfile->filebot)
+			visible = TRUE;
+
+	openfile->current = spot;
+	openfile->current_x = spot->length;
+
+	ingraft_buffer(topline);
+
+	if (follow) {
+		openfile->current = openfile->filebot;
+		openfile->current_x = openfile->filebot->length;
+		focusing = FALSE;
+		visible = TRUE;
+	} else {
+		openfile->current = was_current;
+		openfile->current_x = was_x;
+	}
+
+	openfile->placewewant = xplustabs();
+
+#ifdef ENABLE_COLOR
+	/* Only the lines from the one that got extended need new multidata. */
+	if (HAS_MULTIDATA(openfile->filetop))
+		precalc_multicolorinfo_from(spot);
+#endif
+
+	return visible;
+}
+
+/* Read (at most a slice of) the data that was added to the file of the current
+ * buffer beyond what was read before, and add it to the end of the buffer.
+ * When following the file and the cursor is on the last line, move it along.
+ * Return TRUE when the part of the buffer that is on screen changed. */
+bool catch_up_with_file(void)
+{
+	bool at_the_end = (openfile->current == openfile->filebot && !openfile->loading);
+	bool was_loading = openfile->loading;
+	bool continuing = FALSE;
+		/* Whether the last line read so far lacked a newline. */
+	bool convert = !ISSET(NO_CONVERT);
+	linestruct *topline, *bottomline;
+	bool visible;
+	blockstruct *store;
+	size_t amount, filled = 0;
+	off_t available;
+	struct stat fileinfo;
+	char *start, *newline;
+	char lastbyte;
+	ssize_t got;
+	int fd;
+
+	if (*openfile->filename == '\0' || openfile->hugefile ||
+				stat(openfile->filename, &fileinfo) < 0 || !S_ISREG(fileinfo.st_mode)) {
+		openfile->loading = FALSE;
+		return FALSE;
+	}
+
+	/* When the file has shrunk, assume it was truncated and start anew --
+	 * or, when it was still being loaded, quietly stop the loading. */
+	if (fileinfo.st_size < openfile->followed) {
+		if (openfile->loading) {
+			openfile->loading = FALSE;
+			return FALSE;
+		}
+		statusline(ALERT, _("File '%s' was truncated"), openfile->filename);
+
+		/* Throw away all lines and the undo stack, and read from the start. */
+		free_buffer_lines(openfile->filetop);
+		discard_until(NULL);
+
+		openfile->filetop = make_new_node(NULL);
+		openfile->filetop->data = copy_of("");
+		openfile->filetop->stamp = openfile->generation;
+		openfile->filebot = openfile->filetop;
+		openfile->current = openfile->filetop;
+		openfile->current_x = 0;
+		openfile->placewewant = 0;
+		openfile->edittop = openfile->filetop;
+		openfile->firstcolumn = 0;
+		openfile->mark = NULL;
+		openfile->totsize = 0;
+#ifdef ENABLE_WRAPPING
+		openfile->spillage_line = NULL;
+#endif
+		openfile->current_undo = NULL;
+		openfile->last_saved = NULL;
+		openfile->last_action = OTHER;
+		openfile->followed = 0;
+
+		at_the_end = TRUE;
+		refresh_needed = TRUE;
+	}
+
+	available = fileinfo.st_size - openfile->followed;
+	amount = (available > LOADING_SLICE) ? LOADING_SLICE : available;
+
+	if (amount == 0 || (fd = open(openfile->filename, O_RDONLY)) < 0) {
+		openfile->loading = FALSE;
+		return FALSE;
+	}
+
+	/* Check whether the data read so far ended with a newline. */
+	if (openfile->followed > 0 && lseek(fd, openfile->followed - 1, SEEK_SET) >= 0 &&
+											read(fd, &lastbyte, 1) == 1)
+		continuing = (lastbyte != '\n');
+	else if (lseek(fd, openfile->followed, SEEK_SET) < 0) {
+		close(fd);
+		return FALSE;
+	}
+
+	store = new_text_block(amount);
+
+	while (store && filled < amount && (got = read(fd, store->start + filled,
+													amount - filled)) > 0)
+		filled += got;
+
+	close(fd);
+
+	if (store == NULL || filled == 0) {
+		if (store)
+			release_text_block(store);
+		openfile->loading = FALSE;
+		return FALSE;
+	}
+
+	topline = make_new_node(NULL);
+	bottomline = topline;
+	start = store->start;
+
+	/* Split the new data into lines.  When it is a sizable amount, let the
+	 * lines point into the block, as read_file() does; a small amount (as
+	 * when following a file) gets copied, so that blocks don't pile up. */
+	while ((newline = memchr(start, '\n', store->start + filled - start))) {
+		size_t piece = newline - start;
+
+		if (convert && piece > 0 && start[piece - 1] == '\r')
+			piece--;
+
+		if (filled < BLOCKSIZE)
+			encode_data(bottomline, start, piece);
+		else {
+			start[piece] = '\0';
+			if (memchr(start, '\0', piece))
+				recode_NUL_to_LF(start, piece);
+
+			bottomline->data = start;
+			store->users++;
+		}
+
+		remeasure(bottomline);
+		bottomline->next = make_new_node(bottomline);
+		bottomline = bottomline->next;
+
+		start = newline + 1;
+	}
+
+	/* When more data is waiting, leave an incomplete last line for the next
+	 * round -- unless it is all there is.  Otherwise, leave just a trailing
+	 * CR unread, as it might get followed by a LF later -- except when it is
+	 * the last byte of a file that is being loaded. */
+	if (filled < available && start > store->start)
+		filled = start - store->start;
+	else if (convert && start < store->start + filled && store->start[filled - 1] == '\r' &&
+								(filled < available || !openfile->loading))
+		filled--;
+
+	openfile->followed += filled;
+
+	encode_data(bottomline, start, store->start + filled - start);
+	remeasure(bottomline);
+
+	if (store->users == 0)
+		release_text_block(store);
+
+	/* When all available data has been read, the loading is complete. */
+	if (openfile->followed == fileinfo.st_size)
+		openfile->loading = FALSE;
+
+	visible = append_lines(topline, bottomline, continuing, at_the_end);
+
+	/* When the loading just finished, number and index all lines. */
+	if (was_loading && !openfile->loading)
+		index_the_lines();
+
+	stat_with_alloc(openfile->filename, &openfile->statinfo);
+
+	return visible;
+}
+
+/* Return TRUE when something (text or the end) has arrived on the given pipe. */
+bool input_has_arrived(int pipe)
+{
+	DWORD available = 0;
+
+	if (!PeekNamedPipe((HANDLE)_get_osfhandle(pipe), NULL, 0, NULL, &available, NULL))
+		return TRUE;
+
+	return (available > 0);
+}
+
+/* Read what has arrived on the pipe that feeds the current buffer, and add the
+ * complete lines to the end of the buffer.  When the pipe got closed, add also
+ * a final incomplete line, and stop reading.  When the cursor is on the last
+ * line, move it along.  Return TRUE when the part of the buffer that is on
+ * screen changed. */
+bool take_in_more_input(void)
+{
+	bool follow = (openfile->current == openfile->filebot &&
+						openfile->filetop != openfile->filebot);
+	bool empty = (openfile->filetop == openfile->filebot);
+		/* Whether no complete line has arrived yet. */
+	bool convert = !ISSET(NO_CONVERT);
+	linestruct *topline, *bottomline;
+	char *chunk, *start, *stop, *newline;
+	DWORD available = 0;
+	ssize_t got = 0;
+	bool visible, ended;
+
+	ended = !PeekNamedPipe((HANDLE)_get_osfhandle(openfile->feed), NULL, 0, NULL,
+												&available, NULL);
+	if (available > LOADING_SLICE)
+		available = LOADING_SLICE;
+
+	/* Append the new data to the incomplete line from the previous round. */
+	chunk = nrealloc(openfile->leftover, openfile->leftlen + available + 1);
+
+	if (available > 0)
+		got = read(openfile->feed, chunk + openfile->leftlen, available);
+	if (got < 0) {
+		ended = TRUE;
+		got = 0;
+	}
+
+	start = chunk;
+	stop = chunk + openfile->leftlen + got;
+
+	topline = make_new_node(NULL);
+	bottomline = topline;
+
+	/* Split the data into lines, the same way as read_file() does, and set
+	 * the format of the buffer according to the first line break. */
+	while ((newline = memchr(start, '\n', stop - start))) {
+		size_t piece = newline - start;
+		bool with_cr = (convert && piece > 0 && start[piece - 1] == '\r');
+
+		if (openfile->fmt == UNSPECIFIED)
+			openfile->fmt = (with_cr && !ISSET(MAKE_IT_UNIX)) ? DOS_FILE : NIX_FILE;
+
+		encode_data(bottomline, start, with_cr ? piece - 1 : piece);
+		remeasure(bottomline);
+		bottomline->next = make_new_node(bottomline);
+		bottomline = bottomline->next;
+
+		start = newline + 1;
+	}
+
+	openfile->leftlen = stop - start;
+
+	/* Keep an incomplete last line for the next round -- unless the writing
+	 * side has finished, in which case this line is the last one. */
+	if (ended) {
+		encode_data(bottomline, start, openfile->leftlen);
+		free(chunk);
+		openfile->leftover = NULL;
+		openfile->leftlen = 0;
+		close(openfile->feed);
+		openfile->feed = -1;
+		if (openfile->fmt == UNSPECIFIED)
+			openfile->fmt = NIX_FILE;
+	} else {
+		bottomline->data = copy_of("");
+		memmove(chunk, start, openfile->leftlen);
+		openfile->leftover = chunk;
+	}
+
+	remeasure(bottomline);
+
+	if (!ISSET(VIEW_MODE) && (topline != bottomline || bottomline->length > 0))
+		set_modified();
+
+	visible = append_lines(topline, bottomline, FALSE, follow);
+
+#ifdef ENABLE_COLOR
+	/* Once the first line has arrived, the syntax can be chosen by it.
+	 * If the syntax changed, discard and recompute the multidata. */
+	if (empty && (openfile->filetop != openfile->filebot || ended)) {
+		syntaxtype *was_syntax = openfile->syntax;
+
+		find_and_prime_applicable_syntax();
+
+		if (openfile->syntax != was_syntax) {
+			for (linestruct *line = openfile->filetop; line != NULL; line = line->next)
+				discard_multidata(line);
+
+			precalc_multicolorinfo();
+			have_palette = FALSE;
+			refresh_needed = TRUE;
+		}
+	}
+#endif
+
+	return visible;
+}
+
+/* Return how much of the file of the current buffer has been read, in percent. */
+int loaded_percentage(void)
+{
+	if (openfile->statinfo == NULL || openfile->statinfo->st_size == 0)
+		return 100;
+
+	return (int)(openfile->followed * 100 / openfile->statinfo->st_size);
+}
+
+/* When the file of the current buffer is still being loaded, read the rest of
+ * it.  The user can cut this short with ^C, which then ends the loading. */
+void finish_loading(void)
+{
+	if (!openfile->loading)
+		return;
+
+	statusbar(_("Loading..."));
+
+	install_handler_for_Ctrl_C();
+	control_C_was_pressed = FALSE;
+
+	while (openfile->loading && !control_C_was_pressed)
+		catch_up_with_file();
+
+	restore_handler_for_Ctrl_C();
+
+	if (control_C_was_pressed) {
+		openfile->loading = FALSE;
+		statusline(ALERT, _("Interrupted"));
+	} else
+		wipe_statusbar();
+
+	control_C_was_pressed = FALSE;
+	refresh_needed = TRUE;
+}
+
+/* The number of lines from one milestone in a huge file to the next. */
+#define STRIDE  1024
+/* The number of lines of a huge file that are kept in memory. */
+#define SPAN  4000
+
+/* If the given start of a line lies at the scanning frontier of the huge file,
+ * move the frontier to the next line, and record it when it is a milestone. */
+void advance_the_frontier(off_t linestart, off_t nextstart)
+{
+	hugestruct *huge = openfile->hugefile;
+
+	if (linestart != huge->scanned)
+		return;
+
+	huge->scanned = nextstart;
+	huge->scanned_lineno++;
+
+	if ((huge->scanned_lineno - 1) % STRIDE == 0) {
+		if (huge->known == huge->room) {
+			huge->room *= 2;
+			huge->milestones = nrealloc(huge->milestones, huge->room * sizeof(off_t));
+		}
+		huge->milestones[huge->known++] = nextstart;
+	}
+}
+
+/* Read the huge file from the given offset onward (where the line with the
+ * given number starts) until the given number of lines has been passed or
+ * the end of the file is reached.  When keep is TRUE, return the passed lines
+ * as a linked list, otherwise just pass them by.  Set *beyond to the offset
+ * of the first line that was not passed, or to -1 when all were passed. */
+linestruct *walk_through_hugefile(off_t start, ssize_t lineno, ssize_t howmany,
+									bool keep, off_t *beyond)
+{
+	hugestruct *huge = openfile->hugefile;
+	char *block = nmalloc(BLOCKSIZE);
+	linestruct *head = NULL, *tail = NULL;
+	off_t linestart = start, offset = start;
+	size_t len = 0, bufsize = 0;
+	char *buf = NULL;
+	ssize_t got = 0;
+
+	if (lseek(fileno(huge->stream), start, SEEK_SET) < 0)
+		got = -1;
+
+	while (got >= 0 && howmany > 0) {
+		char *point = block, *stop;
+
+		got = read(fileno(huge->stream), block, BLOCKSIZE);
+		if (got <= 0)
+			break;
+
+		for (stop = block + got; howmany > 0 && point < stop; howmany--) {
+			char *newline = memchr(point, '\n', stop - point);
+			size_t piece = (newline ? newline : stop) - point;
+			char *text = point;
+
+			if (keep && (len > 0 || newline == NULL)) {
+				if (len + piece > bufsize) {
+					bufsize = 2 * (len + piece);
+					buf = nrealloc(buf, bufsize);
+				}
+				memcpy(buf + len, point, piece);
+				len += piece;
+				text = buf;
+				piece = len;
+			}
+
+			if (newline == NULL)
+				break;
+
+			point = newline + 1;
+			len = 0;
+
+			advance_the_frontier(linestart, offset + (point - block));
+			linestart = offset + (point - block);
+
+			if (!keep) {
+				lineno++;
+				continue;
+			}
+
+			/* Strip a CR before a LF, as when reading a file normally. */
+			if (piece > 0 && text[piece - 1] == '\r' && !ISSET(NO_CONVERT)) {
+				if (lineno == 1)
+					openfile->fmt = DOS_FILE;
+				piece--;
+			}
+
+			tail = make_new_node(tail);
+			tail->lineno = lineno++;
+			encode_data(tail, text, piece);
+			remeasure(tail);
+			if (tail->prev)
+				tail->prev->next = tail;
+			else
+				head = tail;
+		}
+
+		offset += got;
+	}
+
+	free(block);
+
+	/* When the end of the file was reached, the remainder is the last line. */
+	if (got == 0 && howmany > 0) {
+		if (linestart == huge->scanned)
+			huge->lastline = lineno;
+
+		if (keep) {
+			tail = make_new_node(tail);
+			tail->lineno = lineno;
+			encode_data(tail, buf ? buf : "", len);
+			remeasure(tail);
+			if (tail->prev)
+				tail->prev->next = tail;
+			else
+				head = tail;
+		}
+
+		*beyond = -1;
+	} else
+		*beyond = linestart;
+
+	free(buf);
+
+	/* When something went wrong, make sure there is at least an empty line. */
+	if (keep && head == NULL) {
+		head = make_new_node(NULL);
+		head->lineno = lineno;
+		head->data = copy_of("");
+	}
+
+	return head;
+}
+
+/* Scan the huge file for line starts until the line with the given number. */
+void scan_hugefile_until(ssize_t lineno)
+{
+	hugestruct *huge = openfile->hugefile;
+	char *block, *point, *stop;
+	off_t offset = huge->scanned;
+	ssize_t got = 0;
+
+	if (huge->lastline > 0 || huge->scanned_lineno >= lineno)
+		return;
+
+	if (lseek(fileno(huge->stream), offset, SEEK_SET) < 0)
+		return;
+
+	block = nmalloc(BLOCKSIZE);
+
+	statusbar(_("Scanning..."));
+
+	install_handler_for_Ctrl_C();
+	control_C_was_pressed = FALSE;
+
+	while (huge->scanned_lineno < lineno && !control_C_was_pressed) {
+		got = read(fileno(huge->stream), block, BLOCKSIZE);
+
+		if (got == 0)
+			huge->lastline = huge->scanned_lineno;
+		if (got <= 0)
+			break;
+
+		point = block;
+		stop = block + got;
+
+		while ((point = memchr(point, '\n', stop - point)) != NULL) {
+			point++;
+			advance_the_frontier(huge->scanned, offset + (point - block));
+		}
+
+		offset += got;
+	}
+
+	restore_handler_for_Ctrl_C();
+
+	if (control_C_was_pressed)
+		statusline(ALERT, _("Interrupted"));
+	else if (got < 0)
+		statusline(ALERT, "%s", strerror(errno));
+	else
+		wipe_statusbar();
+
+	control_C_was_pressed = FALSE;
+	free(block);
+}
+
+/* Return the number of the last line of the huge file. */
+ssize_t last_line_of_hugefile(void)
+{
+	scan_hugefile_until(HIGHEST_POSITIVE);
+
+	return (openfile->hugefile->lastline > 0) ? openfile->hugefile->lastline :
+												openfile->hugefile->scanned_lineno;
+}
+
+/* Return the offset of the line with the given number in the huge file.
+ * When there is no such line, reduce the number to the last known line. */
+off_t offset_of_line(ssize_t *lineno)
+{
+	hugestruct *huge = openfile->hugefile;
+	ssize_t index;
+	off_t offset;
+
+	scan_hugefile_until(*lineno);
+
+	if (*lineno > huge->scanned_lineno)
+		*lineno = huge->scanned_lineno;
+	if (huge->lastline > 0 && *lineno > huge->lastline)
+		*lineno = huge->lastline;
+
+	/* Start at the nearest preceding milestone, and skip the remaining lines. */
+	index = (*lineno - 1) / STRIDE;
+	walk_through_hugefile(huge->milestones[index], index * STRIDE + 1,
+							*lineno - 1 - index * STRIDE, FALSE, &offset);
+	return offset;
+}
+
+/* Return the node in the window for the line with the given number, if any. */
+linestruct *node_in_window(ssize_t lineno)
+{
+	linestruct *line = openfile->filetop;
+
+	if (lineno < lineno_of(line) || lineno > lineno_of(openfile->filebot))
+		return NULL;
+
+	while (lineno_of(line) < lineno)
+		line = line->next;
+
+	return line;
+}
+
+/* Replace the lines in the window into the huge file with the lines around
+ * the given line number, and return the node for this line (or for the last
+ * line when the file is shorter).  The cursor, the top of the viewport, and
+ * the mark stay on the same line when this line is still in the window. */
+linestruct *move_window_to(ssize_t lineno)
+{
+	ssize_t was_current = lineno_of(openfile->current);
+	ssize_t was_edittop = lineno_of(openfile->edittop);
+	ssize_t was_mark = (openfile->mark ? lineno_of(openfile->mark) : 0);
+	ssize_t topline = (lineno > SPAN / 2) ? lineno - SPAN / 2 : 1;
+	off_t offset = offset_of_line(&topline);
+	linestruct *line;
+	off_t beyond;
+
+	free_buffer_lines(openfile->filetop);
+
+	openfile->filetop = walk_through_hugefile(offset, topline, SPAN, TRUE, &beyond);
+	openfile->hugefile->reached_end = (beyond < 0);
+
+	for (line = openfile->filetop; line->next != NULL; line = line->next)
+		;
+	openfile->filebot = line;
+
+	index_the_lines();
+
+	if (lineno > lineno_of(openfile->filebot))
+		lineno = lineno_of(openfile->filebot);
+
+	line = node_in_window(lineno);
+
+	openfile->current = node_in_window(was_current);
+	openfile->edittop = node_in_window(was_edittop);
+	openfile->mark = node_in_window(was_mark);
+
+	if (openfile->current == NULL) {
+		openfile->current = line;
+		openfile->current_x = 0;
+	}
+	if (openfile->edittop == NULL) {
+		openfile->edittop = openfile->current;
+		openfile->firstcolumn = 0;
+	}
+
+#ifdef ENABLE_COLOR
+	recook = TRUE;
+#endif
+	refresh_needed = TRUE;
+
+	return line;
+}
+
+/* When the cursor has come close to an edge of the window into the huge file
+ * (that is not an edge of the file itself), center the window on the cursor. */
+void keep_window_around_cursor(void)
+{
+	ssize_t lineno = lineno_of(openfile->current);
+
+	if ((lineno - lineno_of(openfile->filetop) < SPAN / 4 && lineno_of(openfile->filetop) > 1) ||
+				(lineno_of(openfile->filebot) - lineno < SPAN / 4 &&
+				!openfile->hugefile->reached_end))
+		move_window_to(lineno);
+}
+
+/* Return the node for the line with the given number in the huge file: from
+ * the window, or else from a batch of lines that is fetched from the file.
+ * A batch going backward runs from the preceding milestone up to the line;
+ * a batch going forward runs from the line onward.  Return NULL when the
+ * file does not have the given line. */
+linestruct *fetch_for_search(ssize_t lineno, bool backward)
+{
+	hugestruct *huge = openfile->hugefile;
+	linestruct *line = node_in_window(lineno);
+	ssize_t topline = lineno, howmany = STRIDE;
+	off_t offset;
+
+	if (line || lineno < 1 || (huge->lastline > 0 && lineno > huge->lastline))
+		return line;
+
+	/* Do not let a batch overlap with the window. */
+	if (backward) {
+		topline = ((lineno - 1) / STRIDE) * STRIDE + 1;
+		if (lineno > lineno_of(openfile->filebot) && topline <= lineno_of(openfile->filebot))
+			topline = lineno_of(openfile->filebot) + 1;
+		howmany = lineno - topline + 1;
+	} else if (topline < lineno_of(openfile->filetop) && topline + howmany > lineno_of(openfile->filetop))
+		howmany = lineno_of(openfile->filetop) - topline;
+
+	if (topline == huge->batch_next && huge->batch_beyond >= 0)
+		offset = huge->batch_beyond;
+	else
+		offset = offset_of_line(&topline);
+
+	free_lines(huge->batch);
+	huge->batch = walk_through_hugefile(offset, topline, howmany, TRUE, &huge->batch_beyond);
+	huge->batch_next = topline + howmany;
+
+	for (line = huge->batch; lineno_of(line) < lineno && line->next; line = line->next)
+		;
+
+	return (lineno_of(line) == lineno) ? line : NULL;
+}
+
+/* Return the line before or after the given line in the huge file, fetching
+ * lines from outside of the window when needed.  Return NULL when the given
+ * line is the first or the last line of the file. */
+linestruct *neighbor_in_hugefile(linestruct *line, bool backward)
+{
+	linestruct *neighbor = (backward ? line->prev : line->next);
+
+	if (neighbor)
+		return neighbor;
+	else
+		return fetch_for_search(lineno_of(line) + (backward ? -1 : 1), backward);
+}
+
+/* Free the lines that were fetched from outside of the window. */
+void drop_fetched_batch(void)
+{
+	if (openfile->hugefile) {
+		free_lines(openfile->hugefile->batch);
+		openfile->hugefile->batch = NULL;
+		openfile->hugefile->batch_next = 0;
+	}
+}
+
+/* Set things up for viewing a huge file through a window: only the lines
+ * around the cursor are read in, and lines are fetched again when needed. */
+void open_hugefile(FILE *f)
+{
+	hugestruct *huge = nmalloc(sizeof(hugestruct));
+	off_t beyond;
+
+	huge->stream = f;
+	huge->room = 64;
+	huge->milestones = nmalloc(huge->room * sizeof(off_t));
+	huge->milestones[0] = 0;
+	huge->known = 1;
+	huge->scanned = 0;
+	huge->scanned_lineno = 1;
+	huge->lastline = 0;
+	huge->batch = NULL;
+	huge->batch_next = 0;
+
+	openfile->hugefile = huge;
+
+	free_buffer_lines(openfile->filetop);
+
+	openfile->filetop = walk_through_hugefile(0, 1, SPAN, TRUE, &beyond);
+	huge->reached_end = (beyond < 0);
+
+	openfile->filebot = openfile->filetop;
+	while (openfile->filebot->next)
+		openfile->filebot = openfile->filebot->next;
+
+	index_the_lines();
+
+	openfile->current = openfile->filetop;
+	openfile->edittop = openfile->filetop;
+
+	/* The byte count stands in for the character count, which is unknown. */
+	openfile->totsize = lseek(fileno(f), 0, SEEK_END);
+
+	if (ISSET(MAKE_IT_UNIX) || openfile->fmt == UNSPECIFIED)
+		openfile->fmt = NIX_FILE;
+
+	statusline(REMARK, _("Huge file: reading lines only when needed"));
+}
+#endif /* !NANO_TINY */
+
 /* This function will return the name of the first available extension
  * of a filename (starting with [name][suffix], then [name][suffix].1,
  * etc.).  Memory is allocated for the return value.  If no writable
@@ -969,7 +1913,7 @@ void execute_command(const char *command)
 		/* The pipes through which text will be written and read. */
 	struct sigaction oldaction, newaction = {{0}};
 		/* Original and temporary handlers for SIGINT. */
-	ssize_t was_lineno = (openfile->mark ? 0 : openfile->current->lineno);
+	ssize_t was_lineno = (openfile->mark ? 0 : lineno_of(openfile->current));
 	int command_status, sender_status;
 	bool capture_output = TRUE;
 	FILE *stream;
@@ -1205,7 +2149,7 @@ void insert_a_file_or(bool execute)
 			statusbar(_("Cancelled"));
 			break;
 		} else {
-			ssize_t was_lineno = openfile->current->lineno;
+			ssize_t was_lineno = lineno_of(openfile->current);
 			size_t was_x = openfile->current_x;
 #if !defined(NANO_TINY) || defined(ENABLE_BROWSER) || defined(ENABLE_MULTIBUFFER)
 			functionptrtype function = func_from_key(response);
@@ -1304,7 +2248,7 @@ void insert_a_file_or(bool execute)
 #endif /* ENABLE_MULTIBUFFER */
 			{
 				/* If the buffer actually changed, mark it as modified. */
-				if (openfile->current->lineno != was_lineno || openfile->current_x != was_x)
+				if (lineno_of(openfile->current) != was_lineno || openfile->current_x != was_x)
 					set_modified();
 
 				refresh_needed = TRUE;
@@ -1547,8 +2491,10 @@ int copy_file(FILE *inn, FILE *out, bool close_out)
 #ifndef NANO_TINY
 /* Create a backup of an existing file.  If the user did not request backups,
  * make a temporary one (trying first in the directory of the original file,
- * then in the user's home directory).  Return TRUE if the save can proceed. */
-bool make_backup_of(char *realname, struct stat fileinfo)
+ * then in the user's home directory).  When replaced is TRUE, the file will
+ * get replaced instead of overwritten, so an extra link to it will do as
+ * backup.  Return TRUE if the save can proceed. */
+bool make_backup_of(char *realname, struct stat fileinfo, bool replaced)
 {
 	FILE *original = NULL, *backup_file = NULL;
 	struct timespec filetimes[2];
@@ -1599,6 +2545,33 @@ bool make_backup_of(char *realname, struct stat fileinfo)
 	if (unlink(backupname) < 0 && errno != ENOENT && !ISSET(INSECURE_BACKUP))
 		goto problem;
 
+	/* When the original file is going to be replaced, just keep it around
+	 * under the backup name too -- no data needs to be copied at all. */
+	if (replaced && CreateHardLinkA(backupname, realname, NULL)) {
+		free(backupname);
+		return TRUE;
+	}
+
+	/* Otherwise, first let the system copy the file, which avoids moving
+	 * the data through user space and may clone the blocks instead.
+	 * Then sync the copy before starting to write out the actual file.
+	 * Open the copy just for reading, as it may be read-only, like the
+	 * original whose attributes it got. */
+	if (CopyFileA(realname, backupname, !ISSET(INSECURE_BACKUP))) {
+		descriptor = open(backupname, O_RDONLY);
+
+		if (descriptor < 0)
+			goto problem;
+
+		verdict = fsync(descriptor);
+
+		if (close(descriptor) < 0 || verdict < 0)
+			goto problem;
+
+		free(backupname);
+		return TRUE;
+	}
+
 	creation_flags = O_WRONLY|O_CREAT|(ISSET(INSECURE_BACKUP) ? O_TRUNC : O_EXCL);
 
 	/* Create the backup file (or truncate the existing one). */
@@ -1707,6 +2680,97 @@ bool make_backup_of(char *realname, struct stat fileinfo)
 }
 #endif /* !NANO_TINY */
 
+#define STAGINGSIZE  (1024 * 1024)
+
+/* Copy count bytes of line text into the staging area, decoding any LFs
+ * as the NULs that they are when decode is TRUE. */
+void stage_text(char *staging, const char *text, size_t count, bool decode)
+{
+	memcpy(staging, text, count);
+
+	if (decode) {
+		char *spot = staging, *end = staging + count;
+
+		while ((spot = memchr(spot, '\n', end - spot)) != NULL)
+			*(spot++) = '\0';
+	}
+}
+
+/* Write the lines from the given one onward to the given stream, gathering
+ * them (plus their line endings) into a large staging buffer, so that the
+ * stream gets handed big chunks instead of a few bytes per call.  Store the
+ * number of lines written in lineswritten.  Return FALSE on error. */
+static bool write_lines(FILE *thefile, const linestruct *line, size_t *lineswritten)
+{
+#ifndef NANO_TINY
+	const char *ending = (openfile->fmt == DOS_FILE) ? "\r\n" : "\n";
+#else
+	const char *ending = "\n";
+#endif
+	size_t endlen = strlen(ending);
+	char *staging = nmalloc(STAGINGSIZE);
+	size_t filled = 0;
+	bool okay = TRUE;
+
+	while (okay) {
+		const char *text = line->data;
+		size_t remaining = line->length;
+		bool decode = (memchr(text, '\n', remaining) != NULL);
+
+		while (okay && remaining > 0) {
+			size_t piece = STAGINGSIZE - filled;
+
+			/* A long line without NULs does not need to pass through the
+			 * staging buffer at all when this buffer is empty. */
+			if (filled == 0 && remaining >= STAGINGSIZE && !decode) {
+				okay = (fwrite(text, 1, remaining, thefile) == remaining);
+				break;
+			}
+
+			if (piece > remaining)
+				piece = remaining;
+
+			stage_text(staging + filled, text, piece, decode);
+			filled += piece;
+			text += piece;
+			remaining -= piece;
+
+			if (filled == STAGINGSIZE) {
+				okay = (fwrite(staging, 1, filled, thefile) == filled);
+				filled = 0;
+			}
+		}
+
+		/* If we've reached the last line of the buffer, don't write a newline
+		 * character after it.  If this last line is empty, it means zero bytes
+		 * are written for it, and we don't count it in the number of lines. */
+		if (!okay || line->next == NULL) {
+			if (okay && line->length > 0)
+				(*lineswritten)++;
+			break;
+		}
+
+		if (filled + endlen > STAGINGSIZE) {
+			okay = (fwrite(staging, 1, filled, thefile) == filled);
+			filled = 0;
+		}
+
+		/* Add the newline (preceded with a carriage return for a DOS file). */
+		memcpy(staging + filled, ending, endlen);
+		filled += endlen;
+
+		line = line->next;
+		(*lineswritten)++;
+	}
+
+	if (okay && filled > 0)
+		okay = (fwrite(staging, 1, filled, thefile) == filled);
+
+	free(staging);
+
+	return okay;
+}
+
 /* Write the current buffer to disk.  If `thefile` isn't NULL, it is
  * an already-open temporary file.  If `method` is APPEND or PREPEND,
  * append or prepend to the given file, instead of overwriting it.
@@ -1719,6 +2783,8 @@ bool write_file(const char *name, FILE *thefile, writing_type method, bool annot
 		/* Becomes TRUE when the file is non-temporary and exists. */
 	struct stat fileinfo;
 		/* The status fields filled in by statting the file. */
+	char *sidename = NULL;
+		/* The name of the new file that will replace the existing one. */
 #endif
 	char *realname = expand_leading_tilde(name);
 		/* The filename after tilde expansion. */
@@ -1726,8 +2792,6 @@ bool write_file(const char *name, FILE *thefile, writing_type method, bool annot
 		/* The descriptor that gets assigned when opening the file. */
 	char *tempname = NULL;
 		/* The name of the temporary file we use when prepending. */
-	linestruct *line = openfile->filetop;
-		/* An iterator for moving through the lines of the buffer. */
 	size_t lineswritten = 0;
 		/* The number of lines written, for feedback on the status bar. */
 	bool normal = (method != SPECIAL);
@@ -1745,10 +2809,38 @@ bool write_file(const char *name, FILE *thefile, writing_type method, bool annot
 	/* Check whether the file (at the end of the symlink) exists. */
 	is_existing_file = normal && stat(realname, &fileinfo) == 0;
 
+	/* When asked to, and when overwriting a regular file that is not a link
+	 * and has a single name, write to a new file beside it instead, and later
+	 * put this new file in place of the original one. */
+	if (ISSET(ATOMIC_SAVE) && method == OVERWRITE && thefile == NULL &&
+				is_existing_file && S_ISREG(fileinfo.st_mode) && fileinfo.st_nlink == 1) {
+		struct stat linkinfo;
+
+		if (lstat(realname, &linkinfo) == 0 && S_ISREG(linkinfo.st_mode)) {
+			sidename = nmalloc(strlen(realname) + 8);
+			sprintf(sidename, "%s.XXXXXX", realname);
+
+			descriptor = mkstemp(sidename);
+
+			/* When no new file can be made there, overwrite the original. */
+			if (descriptor < 0) {
+				free(sidename);
+				sidename = NULL;
+			}
+#ifdef HAVE_FCHMOD
+			else
+				IGNORE_CALL_RESULT(fchmod(descriptor, fileinfo.st_mode));
+#endif
+		}
+	}
+
 	/* Make a backup only for a file that exists and is a regular file. */
 	if (ISSET(MAKE_BACKUP) && is_existing_file && !S_ISFIFO(fileinfo.st_mode))
-		if (!make_backup_of(realname, fileinfo))
+		if (!make_backup_of(realname, fileinfo, sidename != NULL)) {
+			if (sidename)
+				close(descriptor);
 			goto cleanup_and_exit;
+		}
 
 	/* When prepending, first copy the existing file to a temporary file. */
 	if (method == PREPEND) {
@@ -1804,6 +2896,10 @@ bool write_file(const char *name, FILE *thefile, writing_type method, bool annot
 			install_handler_for_Ctrl_C();
 #endif
 
+#ifndef NANO_TINY
+		/* When replacing the file, the new one was created above. */
+		if (sidename == NULL)
+#endif
 		/* Now open the file.  Use O_EXCL for an emergency file. */
 		descriptor = open(realname, O_WRONLY | O_CREAT | ((method == APPEND) ?
 					O_APPEND : (normal ? O_TRUNC : O_EXCL)), permissions);
@@ -1839,45 +2935,10 @@ bool write_file(const char *name, FILE *thefile, writing_type method, bool annot
 	if (normal)
 		statusbar(_("Writing..."));
 
-	while (TRUE) {
-		size_t data_len, wrote;
-
-		/* Decode LFs as the NULs that they are, before writing to disk. */
-		data_len = recode_LF_to_NUL(line->data);
-
-		wrote = fwrite(line->data, 1, data_len, thefile);
-
-		/* Re-encode any embedded NULs as LFs. */
-		recode_NUL_to_LF(line->data, data_len);
-
-		if (wrote < data_len) {
-			statusline(ALERT, _("Error writing %s: %s"), realname, strerror(errno));
-			fclose(thefile);
-			goto cleanup_and_exit;
-		}
-
-		/* If we've reached the last line of the buffer, don't write a newline
-		 * character after it.  If this last line is empty, it means zero bytes
-		 * are written for it, and we don't count it in the number of lines. */
-		if (line->next == NULL) {
-			if (line->data[0])
-				lineswritten++;
-			break;
-		}
-
-		/* Write the newline (preceded with a carriage return for a DOS file). */
-		if (
-#ifndef NANO_TINY
-			(openfile->fmt == DOS_FILE && putc('\r', thefile) == EOF) ||
-#endif
-											putc('\n', thefile) == EOF) {
-			statusline(ALERT, _("Error writing %s: %s"), realname, strerror(errno));
-			fclose(thefile);
-			goto cleanup_and_exit;
-		}
-
-		line = line->next;
-		lineswritten++;
+	if (!write_lines(thefile, openfile->filetop, &lineswritten)) {
+		statusline(ALERT, _("Error writing %s: %s"), realname, strerror(errno));
+		fclose(thefile);
+		goto cleanup_and_exit;
 	}
 
 #ifndef NANO_TINY
@@ -1921,7 +2982,11 @@ bool write_file(const char *name, FILE *thefile, writing_type method, bool annot
 
   cleanup_and_exit:
 #ifndef NANO_TINY
-		if (errno == ENOSPC && normal) {
+		/* When writing to a new file, the original is still intact. */
+		if (sidename) {
+			unlink(sidename);
+			free(sidename);
+		} else if (errno == ENOSPC && normal) {
 			napms(3200); lastmessage = VACUUM;
 			/* TRANSLATORS: This warns for data loss when the disk is full. */
 			statusline(ALERT, _("File on disk has been truncated!"));
@@ -1938,6 +3003,22 @@ bool write_file(const char *name, FILE *thefile, writing_type method, bool annot
 		return FALSE;
 	}
 
+#ifndef NANO_TINY
+	/* Put the new file in place of the original one, retaining the attributes
+	 * of the original where possible, else by simply moving the file there. */
+	if (sidename) {
+		if (!ReplaceFileA(realname, sidename, NULL, REPLACEFILE_IGNORE_MERGE_ERRORS,
+										NULL, NULL) &&
+				!MoveFileExA(sidename, realname,
+										MOVEFILE_REPLACE_EXISTING|MOVEFILE_WRITE_THROUGH)) {
+			statusline(ALERT, _("Error writing %s: %s"), realname, _("Cannot replace the file"));
+			goto cleanup_and_exit;
+		}
+
+		free(sidename);
+	}
+#endif
+
 	/* When having written an entire buffer, update some administrivia. */
 	if (annotate && method == OVERWRITE) {
 		/* If the filename was changed, write a new lockfile when needed,
@@ -1960,10 +3041,8 @@ bool write_file(const char *name, FILE *thefile, writing_type method, bool annot
 
 			/* If the syntax changed, discard and recompute the multidata. */
 			if (openfile->syntax != was_syntax) {
-				for (line = openfile->filetop; line != NULL; line = line->next) {
-					free(line->multidata);
-					line->multidata = NULL;
-				}
+				for (linestruct *line = openfile->filetop; line != NULL; line = line->next)
+					discard_multidata(line);
 
 				precalc_multicolorinfo();
 				have_palette = FALSE;
@@ -1975,6 +3054,9 @@ bool write_file(const char *name, FILE *thefile, writing_type method, bool annot
 		/* Get or update the stat info to reflect the current state. */
 		stat_with_alloc(realname, &openfile->statinfo);
 
+		/* When following the file, continue from the end of what was written. */
+		openfile->followed = (openfile->statinfo ? openfile->statinfo->st_size : 0);
+
 		/* Record at which point in the undo stack the buffer was saved. */
 		openfile->last_saved = openfile->current_undo;
 		openfile->last_action = OTHER;
@@ -2004,7 +3086,7 @@ bool write_region_to_file(const char *name, FILE *stream, writing_type method)
 {
 	linestruct *birthline, *topline, *botline, *stopper, *afterline;
 	char *was_datastart, saved_byte;
-	size_t top_x, bot_x;
+	size_t top_x, bot_x, top_length, bot_length;
 	bool retval;
 
 	get_region(&topline, &top_x, &botline, &bot_x);
@@ -2020,9 +3102,13 @@ bool write_region_to_file(const char *name, FILE *stream, writing_type method)
 	afterline = botline->next;
 	botline->next = stopper;
 	saved_byte = botline->data[bot_x];
+	top_length = topline->length;
+	bot_length = botline->length;
 	botline->data[bot_x] = '\0';
+	botline->length = bot_x;
 	was_datastart = topline->data;
 	topline->data += top_x;
+	topline->length -= top_x;
 	birthline = openfile->filetop;
 	openfile->filetop = topline;
 
@@ -2031,7 +3117,9 @@ bool write_region_to_file(const char *name, FILE *stream, writing_type method)
 	/* Restore the proper state of the buffer. */
 	openfile->filetop = birthline;
 	topline->data = was_datastart;
+	topline->length = top_length;
 	botline->data[bot_x] = saved_byte;
+	botline->length = bot_length;
 	botline->next = afterline;
 
 	if (stopper)
@@ -2061,6 +3149,9 @@ int write_it_out(bool exiting, bool withprompt)
 	as_an_at = FALSE;
 
 #ifndef NANO_TINY
+	/* Make sure that the whole file is in the buffer before writing it out. */
+	finish_loading();
+
 	given = copy_of((openfile->mark && !exiting) ? "" : openfile->filename);
 #else
 	given = copy_of(openfile->filename);
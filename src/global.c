@@ -163,6 +163,18 @@ linestruct *cutbottom = NULL;
 bool keep_cutbuffer = FALSE;
 		/* Whether to add to the cutbuffer instead of clearing it first. */
 
+#ifndef NANO_TINY
+grainstruct *grainmap = NULL;
+		/* A hash table that maps each grain of a block of text to the block. */
+size_t grainslots = 0;
+		/* The number of slots in that table (a power of two). */
+size_t grainsused = 0;
+		/* The number of slots that are in use. */
+blockstruct slabmark;
+		/* What the grain map says for a slab of line nodes, as the nodes
+		 * may hold the texts of short lines. */
+#endif
+
 openfilestruct *openfile = NULL;
 		/* The list of all open file buffers. */
 #ifdef ENABLE_MULTIBUFFER
@@ -332,6 +332,7 @@ void wrap_help_text_into_buffer(void)
 	/* Ensure there is a blank line at the top of the text, for esthetics. */
 	if ((ISSET(MINIBAR) || !ISSET(EMPTY_LINE)) && LINES > 6) {
 		openfile->current->data = mallocstrcpy(openfile->current->data, " ");
+		remeasure(openfile->current);
 		openfile->current->next = make_new_node(openfile->current);
 		openfile->current = openfile->current->next;
 	}
@@ -357,6 +358,7 @@ void wrap_help_text_into_buffer(void)
 
 		free(openfile->current->data);
 		openfile->current->data = oneline;
+		remeasure(openfile->current);
 
 		ptr += length;
 		if (*ptr != '\n')
@@ -381,7 +383,7 @@ void wrap_help_text_into_buffer(void)
 
 	/* Move to the position in the file where we were before. */
 	while (TRUE) {
-		sum += strlen(openfile->current->data);
+		sum += openfile->current->length;
 		if (sum > location)
 			break;
 		openfile->current = openfile->current->next;
@@ -489,7 +491,7 @@ void show_help(void)
 		} else if (function == do_up || function == do_scroll_up) {
 			do_scroll_up();
 		} else if (function == do_down || function == do_scroll_down) {
-			if (openfile->edittop->lineno + editwinrows - 1 < openfile->filebot->lineno)
+			if (lineno_of(openfile->edittop) + editwinrows - 1 < lineno_of(openfile->filebot))
 				do_scroll_down();
 		} else if (function == do_page_up || function == do_page_down ||
 					function == to_first_line || function == to_last_line) {
@@ -529,7 +531,7 @@ void show_help(void)
 
 		/* Count how far (in bytes) edittop is into the file. */
 		while (line != openfile->edittop) {
-			location += strlen(line->data);
+			location += line->length;
 			line = line->next;
 		}
 	}
@@ -121,7 +121,9 @@ void update_history(linestruct **item, const char *text, bool avoid_duplicates)
 			*htop = after;
 
 		unlink_node(thesame);
-		renumber_from(after);
+
+		for (linestruct *item = after; item != NULL; item = item->next)
+			item->lineno--;
 	}
 
 	/* If the history is full, delete the oldest item (the one at the
@@ -131,11 +133,14 @@ void update_history(linestruct **item, const char *text, bool avoid_duplicates)
 
 		*htop = (*htop)->next;
 		unlink_node(oldest);
-		renumber_from(*htop);
+
+		for (linestruct *item = *htop; item != NULL; item = item->next)
+			item->lineno--;
 	}
 
 	/* Store the fresh string in the last item, then create a new item. */
 	(*hbot)->data = mallocstrcpy((*hbot)->data, text);
+	remeasure(*hbot);
 	splice_node(*hbot, make_new_node(*hbot));
 	*hbot = (*hbot)->next;
 	(*hbot)->data = copy_of("");
@@ -562,7 +567,7 @@ void update_positions_register(void)
 	}
 
 	/* Record the last cursor position and any anchors. */
-	item->linenumber = openfile->current->lineno;
+	item->linenumber = lineno_of(openfile->current);
 	item->columnnumber = xplustabs() + 1;
 	free(item->anchors);
 	item->anchors = stringify_anchors();
@@ -26,6 +26,10 @@
 /* Move to the first line of the file. */
 void to_first_line(void)
 {
+#ifndef NANO_TINY
+	if (openfile->hugefile)
+		move_window_to(1);
+#endif
 	openfile->current = openfile->filetop;
 	openfile->current_x = 0;
 	openfile->placewewant = 0;
@@ -36,8 +40,14 @@ void to_first_line(void)
 /* Move to the last line of the file. */
 void to_last_line(void)
 {
+#ifndef NANO_TINY
+	if (openfile->hugefile)
+		move_window_to(last_line_of_hugefile());
+	else
+		finish_loading();
+#endif
 	openfile->current = openfile->filebot;
-	openfile->current_x = (inhelp) ? 0 : strlen(openfile->filebot->data);
+	openfile->current_x = (inhelp) ? 0 : openfile->filebot->length;
 	openfile->placewewant = xplustabs();
 
 	/* Set the last line of the screen as the target for the cursor. */
@@ -74,11 +84,11 @@ void get_edge_and_target(size_t *leftedge, size_t *target_column)
 size_t proper_x(linestruct *line, size_t *leftedge, bool forward,
 				size_t column, bool *shifted)
 {
-	size_t index = actual_x(line->data, column);
+	size_t index = actual_x_in(line, column);
 
 #ifndef NANO_TINY
 	if (ISSET(SOFTWRAP) && line->data[index] == '\t' &&
-				((forward && wideness(line->data, index) < *leftedge) ||
+				((forward && wideness_in(line, index) < *leftedge) ||
 				(!forward && column / tabsize == (*leftedge - 1) / tabsize &&
 				column / tabsize < (*leftedge + editwincols - 1) / tabsize))) {
 		index++;
@@ -88,7 +98,7 @@ size_t proper_x(linestruct *line, size_t *leftedge, bool forward,
 	}
 
 	if (ISSET(SOFTWRAP))
-		*leftedge = leftedge_for(wideness(line->data, index), line);
+		*leftedge = leftedge_for(wideness_in(line, index), line);
 #endif
 
 	return index;
@@ -278,7 +288,7 @@ void to_para_end(void)
 		openfile->current = openfile->current->next;
 		openfile->current_x = 0;
 	} else
-		openfile->current_x = strlen(openfile->current->data);
+		openfile->current_x = openfile->current->length;
 
 	edit_redraw(was_current, CENTERING);
 #ifdef ENABLE_COLOR
@@ -342,7 +352,7 @@ void do_prev_word(void)
 			if (openfile->current->prev == NULL)
 				break;
 			openfile->current = openfile->current->prev;
-			openfile->current_x = strlen(openfile->current->data);
+			openfile->current_x = openfile->current->length;
 		}
 
 		/* Step back one character. */
@@ -519,7 +529,7 @@ void do_end(void)
 {
 	linestruct *was_current = openfile->current;
 	size_t was_column = xplustabs();
-	size_t line_len = strlen(openfile->current->data);
+	size_t line_len = openfile->current->length;
 	bool moved_off_chunk = TRUE;
 
 #ifndef NANO_TINY
@@ -538,7 +548,7 @@ void do_end(void)
 		if (!last_chunk)
 			rightedge--;
 
-		right_x = actual_x(openfile->current->data, rightedge);
+		right_x = actual_x_in(openfile->current, rightedge);
 
 		/* If already at the right edge of the screen, move fully to
 		 * the end of the line.  Otherwise, move to the right edge. */
@@ -657,7 +667,7 @@ void do_left(void)
 #endif
 	} else if (openfile->current != openfile->filetop) {
 		openfile->current = openfile->current->prev;
-		openfile->current_x = strlen(openfile->current->data);
+		openfile->current_x = openfile->current->length;
 	}
 
 	edit_redraw(was_current, FLOWING);
@@ -697,7 +707,7 @@ void do_scroll_left(void)
 
 	openfile->brink -= (openfile->brink < tabsize) ? openfile->brink : (tabsize < 2) ? 2 : tabsize;
 
-	frame_x = actual_x(openfile->current->data, openfile->brink + editwincols - CUSHION - 1);
+	frame_x = actual_x_in(openfile->current, openfile->brink + editwincols - CUSHION - 1);
 
 	if (openfile->current_x > frame_x) {
 		openfile->current_x = frame_x;
@@ -710,7 +720,7 @@ void do_scroll_left(void)
 /* Scroll the viewport horizontally to the right. */
 void do_scroll_right(void)
 {
-	size_t sill = openfile->edittop->lineno + editwinrows;
+	size_t sill = lineno_of(openfile->edittop) + editwinrows;
 	linestruct *line = openfile->current;
 	size_t frame_x;
 
@@ -723,14 +733,14 @@ void do_scroll_right(void)
 
 	/* If the current line does not allow further scrolling, seek
 	 * in the viewport an earlier or later line that does allow it. */
-	while (line != openfile->edittop && breadth(line->data) < openfile->brink + CUSHION)
+	while (line != openfile->edittop && breadth_of(line) < openfile->brink + CUSHION)
 		line = line->prev;
-	while (line->lineno < sill && breadth(line->data) < openfile->brink + CUSHION && line->next)
+	while (lineno_of(line) < sill && breadth_of(line) < openfile->brink + CUSHION && line->next)
 		line = line->next;
-	if (line->lineno < sill && breadth(line->data) >= openfile->brink + CUSHION)
+	if (lineno_of(line) < sill && breadth_of(line) >= openfile->brink + CUSHION)
 		openfile->current = line;
 
-	frame_x = actual_x(openfile->current->data, openfile->brink + CUSHION);
+	frame_x = actual_x_in(openfile->current, openfile->brink + CUSHION);
 
 	if (openfile->current_x < frame_x) {
 		openfile->current_x = frame_x;
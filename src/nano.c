@@ -33,6 +33,7 @@
 #include <langinfo.h>
 #endif
 #include <locale.h>
+#include <stdint.h>
 #include <string.h>
 #ifdef HAVE_TERMIOS_H
 #include <termios.h>
@@ -41,6 +42,7 @@
 #ifdef __linux__
 #include <sys/vt.h>
 #endif
+#include <io.h>
 #define WIN32_LEAN_AND_MEAN 1
 #include <windows.h>
 #include <shlobj.h>
@@ -66,25 +68,227 @@ static struct termios original_state;
 static struct sigaction oldaction, newaction;
 		/* Containers for the original and the temporary handler for SIGINT. */
 
+#ifndef NANO_TINY
+static slabstruct *strays = NULL;
+		/* The slabs that do not (or no longer) belong to any buffer. */
+
+/* Return the list of slabs to which the given slab belongs. */
+slabstruct **list_of(slabstruct *slab)
+{
+	return (slab->owner ? &slab->owner->slabs : &strays);
+}
+
+/* Return the slab from which the given node was taken. */
+slabstruct *slab_of(linestruct *node)
+{
+	return (slabstruct *)((uintptr_t)node & ~(uintptr_t)(SLAB_SIZE - 1));
+}
+
+/* Insert the given slab at the head of the given circular list. */
+void hook_slab(slabstruct *slab, slabstruct **list)
+{
+	if (*list == NULL) {
+		slab->next = slab;
+		slab->prev = slab;
+	} else {
+		slab->next = *list;
+		slab->prev = (*list)->prev;
+		slab->prev->next = slab;
+		(*list)->prev = slab;
+	}
+
+	*list = slab;
+}
+
+/* Take the given slab out of the circular list that it is in. */
+void unhook_slab(slabstruct *slab, slabstruct **list)
+{
+	if (slab->next == slab)
+		*list = NULL;
+	else {
+		slab->prev->next = slab->next;
+		slab->next->prev = slab->prev;
+		if (*list == slab)
+			*list = slab->next;
+	}
+}
+
+/* Take a node from the slabs of the current buffer, so that the nodes of
+ * a buffer lie close together.  The slabs that have room are kept at the
+ * front of the list, the full ones at the back. */
+linestruct *node_from_slab(void)
+{
+	slabstruct **list = (openfile ? &openfile->slabs : &strays);
+	slabstruct *slab = *list;
+	linestruct *node;
+
+	if (slab == NULL || (slab->freed == NULL && slab->used == SLAB_NODES)) {
+		/* The allocation granularity of Windows is 64 KiB, so an allocation
+		 * of that size is aligned on it and wastes nothing. */
+		slab = VirtualAlloc(NULL, SLAB_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+		if (slab == NULL)
+			die(_("Nano is out of memory!\n"));
+
+		/* A slab is a single grain; note it, so that the texts that lie
+		 * inside its nodes can be recognized. */
+		map_grain((uintptr_t)slab / GRAIN_SIZE, &slabmark);
+
+		slab->owner = openfile;
+		slab->freed = NULL;
+		slab->used = 0;
+		slab->live = 0;
+
+		hook_slab(slab, list);
+
+		if (openfile) {
+			openfile->slabbytes += SLAB_SIZE;
+			if (openfile->slabbytes > openfile->peakbytes)
+				openfile->peakbytes = openfile->slabbytes;
+		}
+	}
+
+	if (slab->freed) {
+		node = slab->freed;
+		slab->freed = node->next;
+	} else
+		node = &slab->nodes[slab->used++];
+
+	slab->live++;
+
+	/* When the slab is now full, rotate it to the back of the list. */
+	if (slab->freed == NULL && slab->used == SLAB_NODES)
+		*list = slab->next;
+
+	if (openfile)
+		openfile->allocations++;
+
+	return node;
+}
+
+/* Give the given node back to its slab, and free the slab when none of its
+ * nodes are in use any more.  A full slab that gets room moves to the front. */
+void node_to_slab(linestruct *node)
+{
+	slabstruct *slab = slab_of(node);
+	slabstruct **list = list_of(slab);
+	bool was_full = (slab->freed == NULL && slab->used == SLAB_NODES);
+
+	node->next = slab->freed;
+	slab->freed = node;
+
+	if (--slab->live == 0) {
+		unhook_slab(slab, list);
+		if (slab->owner)
+			slab->owner->slabbytes -= SLAB_SIZE;
+		unmap_grain((uintptr_t)slab / GRAIN_SIZE);
+		VirtualFree(slab, 0, MEM_RELEASE);
+	} else if (was_full) {
+		unhook_slab(slab, list);
+		hook_slab(slab, list);
+	}
+}
+
+/* Hand the slabs of the current buffer that are still in use (by lines in the
+ * cutbuffer, for example) over to the strays, so that they outlive the buffer. */
+void disown_slabs(void)
+{
+	while (openfile->slabs) {
+		slabstruct *slab = openfile->slabs;
+
+		unhook_slab(slab, &openfile->slabs);
+		slab->owner = NULL;
+		hook_slab(slab, &strays);
+	}
+}
+#endif
+
 /* Create a new linestruct node.  Note that we do not set prevnode->next. */
 linestruct *make_new_node(linestruct *prevnode)
 {
+#ifndef NANO_TINY
+	linestruct *newnode = node_from_slab();
+#else
 	linestruct *newnode = nmalloc(sizeof(linestruct));
+#endif
 
 	newnode->prev = prevnode;
 	newnode->next = NULL;
 	newnode->data = NULL;
+	newnode->length = 0;
+	newnode->chars = 0;
+	newnode->plain = TRUE;
 #ifdef ENABLE_COLOR
 	newnode->multidata = NULL;
+	newnode->boxed = FALSE;
+	newnode->stale = TRUE;
 #endif
-	newnode->lineno = (prevnode) ? prevnode->lineno + 1 : 1;
+	newnode->lineno = (prevnode) ? lineno_of(prevnode) + 1 : 1;
 #ifndef NANO_TINY
 	newnode->has_anchor = FALSE;
+	newnode->signpost = FALSE;
+	newnode->stamp = 0;
+	newnode->hits = UNCOUNTED;
 #endif
 
 	return newnode;
 }
 
+/* Return a place for a text of the given length (plus its terminating NUL)
+ * for the given line: inside the node when the text is short enough, and
+ * otherwise a new allocation. */
+char *room_for_text(linestruct *line, size_t length)
+{
+#ifndef NANO_TINY
+	if (length < TINY_ROOM)
+		return line->tiny;
+#endif
+	return nmalloc(length + 1);
+}
+
+/* Return the text of the given line in a form that can be kept apart from
+ * the line: a copy when the text lies inside the node, else the text itself. */
+char *detached_text(linestruct *line)
+{
+#ifndef NANO_TINY
+	if (line->data >= line->tiny && line->data < line->tiny + TINY_ROOM)
+		return copy_of(line->data);
+#endif
+	return line->data;
+}
+
+/* Recompute the cached metrics of the given line after its text changed:
+ * its length in bytes, its number of characters, and whether it consists
+ * of only printable ASCII (so that each byte occupies exactly one column).
+ * Also mark the line as needing its matches counted and its multiline
+ * coloring determined again, and drop its remembered coloring. */
+void remeasure(linestruct *line)
+{
+	const char *text = line->data;
+	size_t count = 0;
+	bool plain = TRUE;
+
+	while (*text) {
+		if ((signed char)*text < 0x20 || *text == DEL_CODE) {
+			plain = FALSE;
+			text += char_length(text);
+		} else
+			text++;
+		count++;
+	}
+
+	line->length = text - line->data;
+	line->chars = count;
+	line->plain = plain;
+#ifdef ENABLE_COLOR
+	mark_as_stale(line);
+	forget_the_paint(line);
+#endif
+#ifndef NANO_TINY
+	line->hits = UNCOUNTED;
+#endif
+}
+
 /* Splice a new node into an existing linked list of linestructs. */
 void splice_node(linestruct *afterthis, linestruct *newnode)
 {
@@ -93,6 +297,9 @@ void splice_node(linestruct *afterthis, linestruct *newnode)
 	if (afterthis->next)
 		afterthis->next->prev = newnode;
 	afterthis->next = newnode;
+#ifdef ENABLE_COLOR
+	newnode->stale = TRUE;
+#endif
 
 	/* Update filebot when inserting a node at the end of file. */
 	if (openfile && openfile->filebot == afterthis)
@@ -110,11 +317,23 @@ void delete_node(linestruct *line)
 	if (line == openfile->spillage_line)
 		openfile->spillage_line = NULL;
 #endif
-	free(line->data);
+#ifndef NANO_TINY
+	/* When a line from the index of lines is deleted, let a neighbor take
+	 * its place there. */
+	if (line->signpost)
+		reroute_signposts(lineno_of(line), lineno_of(line),
+							line->prev ? line->prev : line->next);
+#endif
+	free_text(line->data);
 #ifdef ENABLE_COLOR
-	free(line->multidata);
+	discard_multidata(line);
+	forget_the_paint(line);
 #endif
+#ifndef NANO_TINY
+	node_to_slab(line);
+#else
 	free(line);
+#endif
 }
 
 /* Disconnect a node from a linked list of linestructs and delete it. */
@@ -124,6 +343,11 @@ void unlink_node(linestruct *line)
 		line->prev->next = line->next;
 	if (line->next)
 		line->next->prev = line->prev;
+#ifdef ENABLE_COLOR
+	/* The line after the removed one now follows a different line. */
+	if (line->next)
+		mark_as_stale(line->next);
+#endif
 
 	/* Update filebot when removing a node at the end of file. */
 	if (openfile && openfile->filebot == line)
@@ -146,19 +370,88 @@ void free_lines(linestruct *src)
 	delete_node(src);
 }
 
+/* Free the given list of lines of the current buffer.  Instead of giving each
+ * node back to its slab, just count it off, and afterward release in one go
+ * all slabs of the buffer that have become empty. */
+void free_buffer_lines(linestruct *src)
+{
+#ifndef NANO_TINY
+	slabstruct *slab, *next;
+
+	if (src == NULL)
+		return;
+
+	drop_signposts();
+#ifdef ENABLE_WRAPPING
+	openfile->spillage_line = NULL;
+#endif
+
+	while (src) {
+		linestruct *line = src;
+
+		src = src->next;
+
+		free_text(line->data);
+#ifdef ENABLE_COLOR
+		discard_multidata(line);
+		forget_the_paint(line);
+#endif
+		/* A node that came from elsewhere (through a paste) goes back normally. */
+		if (slab_of(line)->owner == openfile)
+			slab_of(line)->live--;
+		else
+			node_to_slab(line);
+	}
+
+	if (openfile->slabs == NULL)
+		return;
+
+	/* Break the circle, and then either free each slab or hook it back in,
+	 * a full one at the back. */
+	slab = openfile->slabs;
+	slab->prev->next = NULL;
+	openfile->slabs = NULL;
+
+	for (; slab != NULL; slab = next) {
+		next = slab->next;
+
+		if (slab->live == 0) {
+			openfile->slabbytes -= SLAB_SIZE;
+			unmap_grain((uintptr_t)slab / GRAIN_SIZE);
+			VirtualFree(slab, 0, MEM_RELEASE);
+		} else {
+			hook_slab(slab, &openfile->slabs);
+			if (slab->freed == NULL && slab->used == SLAB_NODES)
+				openfile->slabs = slab->next;
+		}
+	}
+#else
+	free_lines(src);
+#endif
+}
+
 /* Make a copy of a linestruct node. */
 linestruct *copy_node(const linestruct *src)
 {
+#ifndef NANO_TINY
+	linestruct *dst = node_from_slab();
+#else
 	linestruct *dst = nmalloc(sizeof(linestruct));
+#endif
 
-	dst->data = copy_of(src->data);
+	dst->data = room_for_text(dst, src->length);
+	memcpy(dst->data, src->data, src->length + 1);
 #ifdef ENABLE_COLOR
 	dst->multidata = NULL;
+	dst->boxed = FALSE;
 #endif
-	dst->lineno = src->lineno;
+	dst->lineno = lineno_of(src);
 #ifndef NANO_TINY
 	dst->has_anchor = src->has_anchor;
+	dst->signpost = FALSE;
+	dst->stamp = 0;
 #endif
+	remeasure(dst);
 
 	return dst;
 }
@@ -187,15 +480,246 @@ linestruct *copy_buffer(const linestruct *src)
 	return head;
 }
 
-/* Renumber the lines in a buffer, from the given line onwards. */
+/* Return the number of the given line.  When the numbers of lines have
+ * shifted since this line was last numbered, first bring it up to date. */
+ssize_t lineno_of(const linestruct *line)
+{
+#ifndef NANO_TINY
+	linestruct *theline = (linestruct *)line;
+	size_t index;
+
+	if (line->stamp == 0 || line->stamp == openfile->generation)
+		return line->lineno;
+
+	/* Apply the shifts that happened after the line was last numbered, or
+	 * all of them when it was numbered before the lines were last settled. */
+	if (line->stamp < openfile->settled)
+		index = 0;
+	else
+		index = openfile->shiftcount - (openfile->generation - line->stamp);
+
+	for (; index < openfile->shiftcount; index++)
+		if (theline->lineno >= openfile->shiftfrom[index])
+			theline->lineno += openfile->shiftby[index];
+
+	theline->stamp = openfile->generation;
+#endif
+	return line->lineno;
+}
+
+#ifndef NANO_TINY
+/* Forget the index of lines of the current buffer. */
+void drop_signposts(void)
+{
+	for (size_t index = 0; index < openfile->signcount; index++)
+		openfile->signposts[index]->signpost = FALSE;
+
+	free(openfile->signposts);
+	openfile->signposts = NULL;
+	openfile->signcount = 0;
+}
+
+/* Number all lines of the current buffer afresh, forget all recorded shifts,
+ * and build an index of every SIGNPOST_GAP-th line. */
+void index_the_lines(void)
+{
+	ssize_t number = (openfile->hugefile ? openfile->filetop->lineno : 1);
+	ssize_t estimate = lineno_of(openfile->filebot) - number;
+	size_t room = (estimate > 0 ? estimate : 0) / SIGNPOST_GAP + 1;
+	linestruct *line = openfile->filetop;
+
+	drop_signposts();
+
+	openfile->signposts = nmalloc(room * sizeof(linestruct *));
+	openfile->generation++;
+	openfile->settled = openfile->generation;
+	openfile->shiftcount = 0;
+
+	for (; line != NULL; line = line->next, number++) {
+		line->lineno = number;
+		line->stamp = openfile->generation;
+
+		if ((number - openfile->filetop->lineno) % SIGNPOST_GAP == 0) {
+			if (openfile->signcount == room) {
+				room *= 2;
+				openfile->signposts = nrealloc(openfile->signposts, room * sizeof(linestruct *));
+			}
+			openfile->signposts[openfile->signcount++] = line;
+			line->signpost = TRUE;
+		}
+	}
+}
+
+/* Return the index of the first entry in the index of lines whose line has
+ * a number beyond the given one (when beyond is FALSE: not below it). */
+size_t signpost_after(ssize_t number, bool beyond)
+{
+	size_t lower = 0, upper = openfile->signcount;
+
+	while (lower < upper) {
+		size_t middle = (lower + upper) / 2;
+		ssize_t found = lineno_of(openfile->signposts[middle]);
+
+		if (found < number || (beyond && found == number))
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+
+	return lower;
+}
+
+/* Let the entries in the index of lines for the lines with the given numbers
+ * (which are leaving the buffer) point to the given line instead. */
+void reroute_signposts(ssize_t first, ssize_t last, linestruct *substitute)
+{
+	size_t index = signpost_after(first, FALSE);
+
+	if (substitute == NULL) {
+		drop_signposts();
+		return;
+	}
+
+	for (; index < openfile->signcount &&
+				lineno_of(openfile->signposts[index]) <= last; index++) {
+		openfile->signposts[index]->signpost = FALSE;
+		openfile->signposts[index] = substitute;
+		substitute->signpost = TRUE;
+	}
+}
+
+/* When the stretch of lines between the two entries in the index of lines
+ * around the given (added) line has grown longer than two gaps, give that
+ * stretch an entry every SIGNPOST_GAP lines. */
+void densify_signposts(linestruct *line)
+{
+	size_t index = signpost_after(lineno_of(line), TRUE);
+	linestruct *post = (index > 0) ? openfile->signposts[index - 1] : openfile->filetop;
+	ssize_t number = lineno_of(post);
+	ssize_t reach = (index < openfile->signcount) ?
+						lineno_of(openfile->signposts[index]) :
+						lineno_of(openfile->filebot) + 1;
+	size_t count = (reach - number - 1) / SIGNPOST_GAP;
+
+	if (reach - number <= 2 * SIGNPOST_GAP)
+		return;
+
+	openfile->signposts = nrealloc(openfile->signposts,
+						(openfile->signcount + count) * sizeof(linestruct *));
+	memmove(openfile->signposts + index + count, openfile->signposts + index,
+						(openfile->signcount - index) * sizeof(linestruct *));
+	openfile->signcount += count;
+
+	for (; count > 0; count--, index++) {
+		for (size_t step = 0; step < SIGNPOST_GAP; step++)
+			post = post->next;
+
+		openfile->signposts[index] = post;
+		post->signpost = TRUE;
+	}
+}
+
+/* Number the lines of the current buffer afresh from the given number onward,
+ * and forget all recorded shifts.  The lines that no shift can have reached
+ * keep their numbers, so the numbering starts at the entry in the index of
+ * lines just before the lowest number that a shift touched. */
+void settle_the_numbers(ssize_t lowest)
+{
+	linestruct *line = openfile->filetop;
+	ssize_t number;
+	size_t index;
+
+	for (index = 0; index < openfile->shiftcount; index++) {
+		ssize_t reach = openfile->shiftfrom[index] +
+						(openfile->shiftby[index] < 0 ? openfile->shiftby[index] : 0);
+
+		if (reach < lowest)
+			lowest = reach;
+	}
+
+	index = signpost_after(lowest, FALSE);
+
+	/* The top line may have just taken the place of lines that were cut,
+	 * so do not trust its number. */
+	if (index > 0) {
+		line = openfile->signposts[index - 1];
+		number = lineno_of(line);
+	} else
+		number = (openfile->hugefile ? openfile->filetop->lineno : 1);
+
+	openfile->generation++;
+	openfile->settled = openfile->generation;
+	openfile->shiftcount = 0;
+
+	for (; line != NULL; line = line->next) {
+		line->lineno = number++;
+		line->stamp = openfile->generation;
+	}
+}
+#endif
+
+/* Renumber the lines in a buffer, from the given line onwards.  Instead of
+ * renumbering all subsequent lines, number just the lines that were added,
+ * and record by how much the numbers of the lines after them have shifted,
+ * so that this shift can be applied when the number of such a line is needed. */
 void renumber_from(linestruct *line)
 {
-	ssize_t number = (line->prev == NULL) ? 0 : line->prev->lineno;
+	ssize_t number = (line->prev == NULL) ? 0 : lineno_of(line->prev);
+#ifndef NANO_TINY
+	linestruct *first = line;
+	ssize_t start = number + 1;
+	size_t added = 0;
+	bool settled = FALSE;
+
+	/* Number the new lines, plus the given line itself when it is not new
+	 * but its number is still right (when lines were added after it). */
+	while (line && (line->stamp == 0 || (line == first && lineno_of(line) == number + 1))) {
+		line->lineno = ++number;
+		line = line->next;
+		added++;
+	}
+
+	/* When the lines after the new ones got different numbers, record it. */
+	if (line && lineno_of(line) != number + 1) {
+#ifdef ENABLE_COLOR
+		/* The lines with possibly wrong multiline info shift along. */
+		shift_stale_lines(lineno_of(line), number + 1 - lineno_of(line));
+#endif
+		/* When too many shifts have been recorded, number the lines afresh,
+		 * but only from where the earliest shift had effect. */
+		if (openfile->shiftcount == MAX_SHIFTS) {
+			settle_the_numbers(start);
+			settled = TRUE;
+		} else {
+			if (openfile->shiftfrom == NULL) {
+				openfile->shiftfrom = nmalloc(MAX_SHIFTS * sizeof(ssize_t));
+				openfile->shiftby = nmalloc(MAX_SHIFTS * sizeof(ssize_t));
+			}
+
+			openfile->shiftfrom[openfile->shiftcount] = lineno_of(line);
+			openfile->shiftby[openfile->shiftcount] = number + 1 - lineno_of(line);
+			openfile->shiftcount++;
+			openfile->generation++;
+		}
+	}
+
+	for (; !settled && first != line; first = first->next)
+		first->stamp = openfile->generation;
+
+#ifdef ENABLE_COLOR
+	/* The new lines, and the line after them, need their multiline info redone. */
+	mark_stale_lines(start, number + 1);
+#endif
 
+	/* When lines were added, keep the index of lines dense enough there. */
+	if (number >= start && openfile->signposts)
+		densify_signposts(line ? line->prev : openfile->filebot);
+#else
 	while (line) {
 		line->lineno = ++number;
 		line = line->next;
 	}
+#endif
 }
 
 /* Display a warning about a key disabled in view mode. */
@@ -642,6 +1166,8 @@ void usage(void)
 	print_opt("-_", "--minibar", N_("Show a feedback bar at the bottom"));
 	print_opt("-0", "--zero", N_("Hide all bars, use whole terminal"));
 	print_opt("-1", "--solosidescroll", N_("Scroll only the current line sideways"));
+	print_opt("", "--follow", N_("Keep reading what gets added to the file"));
+	print_opt("", "--incremental", N_("Search already while the string is typed"));
 #endif
 	print_opt("-/", "--modernbindings", N_("Use better-known key bindings"));
 }
@@ -858,6 +1384,22 @@ bool scoop_stdin(void)
 
 	restore_terminal();
 
+	/* When input comes through a pipe, show the buffer right away, and let
+	 * the text be added to it as it arrives, in the manner of a pager. */
+	if (PeekNamedPipe((HANDLE)_get_osfhandle(STDIN_FILENO), NULL, 0, NULL, NULL, NULL) &&
+										(fd = dup(STDIN_FILENO)) >= 0) {
+		make_new_buffer();
+		openfile->feed = fd;
+#ifdef ENABLE_COLOR
+		find_and_prime_applicable_syntax();
+#endif
+		if (GetConsoleWindow() == NULL)
+			reconnect_and_store_state();
+		terminal_init();
+		doupdate();
+		return TRUE;
+	}
+
 	/* When input comes from a terminal, show a helpful message. */
 	if (GetConsoleWindow() != NULL)
 		fprintf(stderr, _("Reading data from keyboard; type ^Z to finish.\n"));
@@ -1254,7 +1796,7 @@ int get_keycode(const char *keyname, const int standard)
 /* Ensure that the margin can accommodate the buffer's highest line number. */
 void confirm_margin(void)
 {
-	int needed_margin = digits(openfile->filebot->lineno) + 1;
+	int needed_margin = digits(lineno_of(openfile->filebot)) + 1;
 
 	/* When not requested or space is too tight, suppress line numbers. */
 	if (!ISSET(LINE_NUMBERS) || needed_margin > COLS - 4)
@@ -1352,7 +1894,7 @@ int process_click(void)
 		else
 			go_forward_chunks(row_count, &openfile->current, &leftedge);
 
-		openfile->current_x = actual_x(openfile->current->data,
+		openfile->current_x = actual_x_in(openfile->current,
 								actual_last_column(leftedge, click_col));
 
 #ifndef NANO_TINY
@@ -1433,10 +1975,11 @@ void suck_up_input_and_paste_it(void)
 		input = get_kbinput(midwin, BLIND);
 
 		if ((0x20 <= input && input <= 0xFF && input != DEL_CODE) || input == '\t') {
-			line->data = nrealloc(line->data, index + 2);
+			line->data = realloc_text(line->data, index + 2);
 			line->data[index++] = (char)input;
 			line->data[index] = '\0';
 		} else if (input == '\r' || input == '\n') {
+			remeasure(line);
 			line->next = make_new_node(line);
 			line = line->next;
 			line->data = copy_of("");
@@ -1445,6 +1988,8 @@ void suck_up_input_and_paste_it(void)
 			break;
 	}
 
+	remeasure(line);
+
 	if (ISSET(VIEW_MODE))
 		print_view_warning();
 	else
@@ -1462,7 +2007,9 @@ void suck_up_input_and_paste_it(void)
 void inject(char *burst, size_t count)
 {
 	linestruct *thisline = openfile->current;
-	size_t datalen = strlen(thisline->data);
+	size_t datalen = thisline->length;
+	size_t was_chars = thisline->chars;
+	bool plain = thisline->plain;
 #ifndef NANO_TINY
 	size_t original_row = 0;
 	size_t old_amount = 0;
@@ -1474,27 +2021,45 @@ void inject(char *burst, size_t count)
 	}
 #endif
 
-	/* Encode an embedded NUL byte as 0x0A. */
-	for (size_t index = 0; index < count; index++)
+	/* Encode an embedded NUL byte as 0x0A, and see whether the burst
+	 * consists of only printable ASCII. */
+	for (size_t index = 0; index < count; index++) {
 		if (burst[index] == '\0')
 			burst[index] = '\n';
+		if ((signed char)burst[index] < 0x20 || burst[index] == DEL_CODE)
+			plain = FALSE;
+	}
 
 #ifndef NANO_TINY
 	/* Only add a new undo item when the current item is not an ADD or when
 	 * the current typing is not contiguous with the previous typing. */
 	if (openfile->last_action != ADD ||
-				openfile->current_undo->tail_lineno != thisline->lineno ||
+				openfile->current_undo->tail_lineno != lineno_of(thisline) ||
 				openfile->current_undo->tail_x != openfile->current_x)
 		add_undo(ADD, NULL);
 #endif
 
 	/* Make room for the new bytes and copy them into the line. */
-	thisline->data = nrealloc(thisline->data, datalen + count + 1);
+	thisline->data = realloc_text(thisline->data, datalen + count + 1);
 	memmove(thisline->data + openfile->current_x + count,
 						thisline->data + openfile->current_x,
 						datalen - openfile->current_x + 1);
 	strncpy(thisline->data + openfile->current_x, burst, count);
 
+	/* When plain text is added to a plain line, no recounting is needed. */
+	if (plain) {
+		thisline->length += count;
+		thisline->chars += count;
+#ifdef ENABLE_COLOR
+		mark_as_stale(thisline);
+		forget_the_paint(thisline);
+#endif
+#ifndef NANO_TINY
+		thisline->hits = UNCOUNTED;
+#endif
+	} else
+		remeasure(thisline);
+
 #ifndef NANO_TINY
 	/* When the cursor is on the top row and not on the first chunk
 	 * of a line, adding text there might change the preceding chunk
@@ -1511,7 +2076,7 @@ void inject(char *burst, size_t count)
 
 	openfile->current_x += count;
 
-	openfile->totsize += mbstrlen(burst);
+	openfile->totsize += thisline->chars - was_chars;
 	set_modified();
 
 	/* If text was added to the magic line, create a new magic line. */
@@ -1561,6 +2126,156 @@ void inject(char *burst, size_t count)
 		update_line(openfile->current, openfile->current_x);
 }
 
+#ifndef NANO_TINY
+/* The number of milliseconds between two checks of a followed file. */
+#define FOLLOW_INTERVAL  500
+#define FEEDING_INTERVAL  100
+
+/* Whether ^C generates an interrupt, so that it can stop a reading. */
+static bool listening = FALSE;
+
+/* Let ^C generate an interrupt (through the usual handler) while the current
+ * buffer is being read and nano is waiting for a keystroke, so that the user
+ * can stop the reading, or let ^C be a normal keystroke again.  When ^C was
+ * pressed in the meantime, stop reading the file or pipe. */
+void listen_for_Ctrl_C(bool listen)
+{
+	if (listening && control_C_was_pressed && (openfile->loading || openfile->feed >= 0)) {
+		if (openfile->feed >= 0)
+			close(openfile->feed);
+		openfile->feed = -1;
+		openfile->loading = FALSE;
+		statusline(ALERT, _("Interrupted"));
+		titlebar(NULL);
+		listen = FALSE;
+	}
+
+	if (listen && !listening)
+		install_handler_for_Ctrl_C();
+	else if (!listen && listening)
+		restore_handler_for_Ctrl_C();
+
+	control_C_was_pressed = FALSE;
+	listening = listen;
+}
+
+/* Return how many milliseconds to wait for a keystroke before doing some
+ * work in the background, or -1 when there is no such work. */
+int background_pause(void)
+{
+	openfilestruct *buffer = openfile;
+	bool feeding = FALSE;
+
+	/* As long as some file is still being loaded, or some text has arrived
+	 * through a pipe, don't wait at all. */
+	do {
+		if (buffer->loading || (buffer->feed >= 0 && input_has_arrived(buffer->feed)))
+			return 0;
+		if (buffer->feed >= 0)
+			feeding = TRUE;
+		buffer = buffer->next;
+	} while (buffer != openfile);
+
+	/* While the matches of a search are being counted, don't wait either. */
+	if (counting_matches())
+		return 0;
+
+#ifdef ENABLE_COLOR
+	/* Nor while lines just beyond the viewport have not been colored yet. */
+	if (coloring_ahead())
+		return 0;
+#endif
+
+	if (feeding)
+		return FEEDING_INTERVAL;
+	else if (ISSET(FOLLOW_MODE))
+		return FOLLOW_INTERVAL;
+
+	return -1;
+}
+
+/* Do a piece of the work that can be done while the user is idle,
+ * and update the screen when this work changed something. */
+void do_background_work(void)
+{
+	openfilestruct *current = openfile;
+	bool was_loading = openfile->loading;
+	bool was_fed = (openfile->feed >= 0);
+
+	/* When ^C was pressed during the reading, stop it. */
+	listen_for_Ctrl_C(was_loading || was_fed);
+
+	was_loading = openfile->loading;
+
+	/* Load a slice of the file of the current buffer, or else of some other
+	 * buffer that is still loading, or else check the followed file. */
+	if (openfile->loading || ISSET(FOLLOW_MODE))
+		refresh_needed |= catch_up_with_file();
+	else {
+		for (openfile = current->next; openfile != current; openfile = openfile->next)
+			if (openfile->loading) {
+				catch_up_with_file();
+				break;
+			}
+
+		openfile = current;
+	}
+
+	/* Add whatever text has arrived through a pipe to its buffer. */
+	do {
+		if (openfile->feed >= 0 && input_has_arrived(openfile->feed) &&
+									take_in_more_input() && openfile == current)
+			refresh_needed = TRUE;
+		openfile = openfile->next;
+	} while (openfile != current);
+
+	/* When the current buffer just finished loading, report its size. */
+	if (was_loading && !openfile->loading && !ISSET(ZERO)) {
+		size_t count = lineno_of(openfile->filebot) - (openfile->filebot->data[0] == '\0');
+
+		if (ISSET(MINIBAR))
+			report_size = TRUE;
+		else if (openfile->fmt == DOS_FILE)
+			statusline(REMARK, P_("Read %zu line (converted from DOS format)",
+							"Read %zu lines (converted from DOS format)", count), count);
+		else
+			statusline(REMARK, P_("Read %zu line", "Read %zu lines", count), count);
+	}
+
+	/* While the current buffer is still being read, let ^C stop it. */
+	listen_for_Ctrl_C(openfile->loading || openfile->feed >= 0);
+
+	/* Count some more matches of the last search, if need be. */
+	count_more_matches();
+
+#ifdef ENABLE_COLOR
+	/* Color some of the lines that will come into view next. */
+	color_some_lines_ahead();
+#endif
+
+	if (LINES == 1)
+		return;
+
+#ifdef ENABLE_LINENUMBERS
+	confirm_margin();
+#endif
+
+	/* Show the progress of the loading in the title bar or the minibar, and
+	 * show the modified state of a buffer that is being fed through a pipe. */
+	if ((was_loading || was_fed) && !ISSET(MINIBAR))
+		titlebar(NULL);
+
+	if ((was_loading || was_fed || refresh_needed) && ISSET(MINIBAR) &&
+								!ISSET(ZERO) && lastmessage < REMARK)
+		minibar();
+
+	if (refresh_needed)
+		edit_refresh();
+
+	doupdate();
+}
+#endif
+
 /* Read in a keystroke, and execute its command or insert it into the buffer. */
 void process_a_keystroke(void)
 {
@@ -1587,6 +2302,9 @@ void process_a_keystroke(void)
 #ifndef NANO_TINY
 	if (input == THE_WINDOW_RESIZED)
 		return;
+
+	/* Whatever the user does, a count of matches is no longer wanted. */
+	stop_counting_matches();
 #endif
 #ifdef ENABLE_MOUSE
 	if (input == KEY_MOUSE) {
@@ -1829,6 +2547,8 @@ int main(int argc, char **argv)
 		{"minibar", 0, NULL, '_'},
 		{"zero", 0, NULL, '0'},
 		{"solosidescroll", 0, NULL, '1'},
+		{"follow", 0, NULL, 0xCD},
+		{"incremental", 0, NULL, 0xCE},
 #endif
 #ifdef HAVE_LIBMAGIC
 		{"magic", 0, NULL, '!'},
@@ -2127,6 +2847,12 @@ int main(int argc, char **argv)
 			case 0xCC:
 				SET(WHITESPACE_DISPLAY);
 				break;
+			case 0xCD:
+				SET(FOLLOW_MODE);
+				break;
+			case 0xCE:
+				SET(INCREMENTAL_SEARCH);
+				break;
 			case '@':
 				SET(COLON_PARSING);
 				break;
@@ -2589,6 +3315,7 @@ int main(int argc, char **argv)
 		}
 #ifndef NANO_TINY
 		else if (searchstring) {
+			finish_loading();
 			openfile->current = openfile->filetop;
 			openfile->current_x = 0;
 			if (ISSET(USE_REGEXP))
@@ -2703,6 +3430,10 @@ int main(int argc, char **argv)
 		}
 #endif
 
+#ifndef NANO_TINY
+		if (openfile->hugefile)
+			keep_window_around_cursor();
+#endif
 		if ((refresh_needed && LINES > 1) || (LINES == 1 && lastmessage <= HUSH))
 			edit_refresh();
 		else
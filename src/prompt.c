@@ -174,6 +174,7 @@ void copy_the_answer(void)
 		free_lines(cutbuffer);
 		cutbuffer = make_new_node(NULL);
 		cutbuffer->data = copy_of(answer);
+		remeasure(cutbuffer);
 		typing_x = 0;
 	}
 }
@@ -181,7 +182,7 @@ void copy_the_answer(void)
 /* Paste the first line of the cutbuffer into the current answer. */
 void paste_into_answer(void)
 {
-	size_t pastelen = strlen(cutbuffer->data);
+	size_t pastelen = cutbuffer->length;
 
 	answer = nrealloc(answer, strlen(answer) + pastelen + 1);
 	memmove(answer + typing_x + pastelen, answer + typing_x, strlen(answer) - typing_x + 1);
@@ -434,6 +435,12 @@ functionptrtype acquire_an_answer(int *actual, bool *listed,
 		typing_x = strlen(answer);
 
 	while (TRUE) {
+#ifndef NANO_TINY
+		/* When searching incrementally, go to the first match of what has been
+		 * typed so far -- unless more keystrokes are waiting to be handled. */
+		if (ISSET(INCREMENTAL_SEARCH) && currmenu == MWHEREIS && waiting_keycodes() == 0)
+			search_as_typed();
+#endif
 		draw_the_promptbar();
 
 		/* Read in one keystroke. */
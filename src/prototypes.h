@@ -111,6 +111,13 @@ extern linestruct *cutbuffer;
 extern linestruct *cutbottom;
 extern bool keep_cutbuffer;
 
+#ifndef NANO_TINY
+extern grainstruct *grainmap;
+extern size_t grainslots;
+extern size_t grainsused;
+extern blockstruct slabmark;
+#endif
+
 extern openfilestruct *openfile;
 #ifdef ENABLE_MULTIBUFFER
 extern openfilestruct *startfile;
@@ -230,7 +237,15 @@ int mbstrcasecmp(const char *s1, const char *s2);
 int mbstrncasecmp(const char *s1, const char *s2, size_t n);
 char *mbstrcasestr(const char *haystack, const char *needle);
 char *revstrstr(const char *haystack, const char *needle, const char *pointer);
-char *mbrevstrcasestr(const char *haystack, const char *needle, const char *pointer);
+void prepare_for_literal_search(const char *needle);
+const char *find_literal(const char *haystack, size_t length, const char *start);
+const char *rfind_literal(const char *haystack, size_t length, const char *start);
+int fold_char(const char *pointer, int *value);
+void prepare_for_caseless_search(const char *needle);
+bool caseless_match_at(const char *haystack, const char *spot, const char *end);
+const char *next_of(const char *start, const char *end, unsigned char byte);
+const char *find_caseless(const char *haystack, size_t length, const char *start);
+const char *rfind_caseless(const char *haystack, size_t length, const char *start);
 #if !defined(NANO_TINY) || defined(ENABLE_JUSTIFY)
 const char *mbstrchr(const char *string, const char *chr);
 #endif
@@ -251,8 +266,51 @@ void strip_leading_blanks_from(char *string);
 void set_interface_colorpairs(void);
 void prepare_palette(void);
 void find_and_prime_applicable_syntax(void);
+void set_to_empty(wordset *set);
+void clear_words(wordset *set);
+void copy_words(wordset *target, const wordset *source);
+bool merge_words(wordset *set, const wordset *more);
+bool join_words(wordset *run, const wordset *tail);
+void consider_words(wordset *best, bool *have_best, const wordset *candidate);
+bool scan_bracket(const char **regex, wordset *set, bool *is_exact);
+bool scan_atom(const char **regex, wordset *exact, bool *is_exact,
+		wordset *needed, bool *has_needed);
+bool scan_repetition(const char **regex, int *least, bool *once);
+bool scan_sequence(const char **regex, wordset *exact, bool *is_exact,
+		wordset *needed, bool *has_needed);
+bool scan_alternation(const char **regex, wordset *exact, bool *is_exact,
+		wordset *needed, bool *has_needed);
+char *literals_in(const char *regex);
+void add_clue(sievetype *sieve, short clue, int state, size_t *listed, size_t *room);
+sievetype *build_a_sieve(char **sets, short *clues, int count);
+void build_the_sieves(syntaxtype *sntx);
+void sift_the_line(const sievetype *sieve, const char *text, bool *found);
 void check_the_multis(linestruct *line);
+short multi_info_of(const colortype *ink, const linestruct *line, bool open,
+		const bool *found);
+#ifndef NANO_TINY
+void mark_stale_lines(ssize_t first, ssize_t last);
+void shift_stale_lines(ssize_t from, ssize_t by);
+#endif
+void mark_as_stale(linestruct *line);
+void provide_multidata(linestruct *line);
+void discard_multidata(linestruct *line);
+void recolor_from(linestruct *line);
+bool recolor_in_parallel(void);
 void precalc_multicolorinfo(void);
+void precalc_multicolorinfo_from(linestruct *line);
+painttype **slot_of(const linestruct *line);
+painttype *painting_of(const linestruct *line);
+void unhash_paint(painttype *paint);
+void unchain_paint(painttype *paint);
+void chain_paint(painttype *paint);
+short info_before(const linestruct *line, short id);
+bool still_right(const painttype *paint, const linestruct *line, size_t reach);
+const painttype *paint_of(linestruct *line, size_t reach);
+bool is_painted(const linestruct *line);
+painttype *fresh_paint_for(linestruct *line, size_t reach);
+void add_span(painttype *paint, size_t start, size_t end, int attributes);
+void forget_the_paint(linestruct *line);
 #endif
 
 /* Most functions in cut.c. */
@@ -295,6 +353,23 @@ void close_buffer(void);
 #endif
 void read_file(FILE *f, int fd, const char *filename, bool undoable);
 int open_file(const char *filename, bool new_one, FILE **f);
+#ifndef NANO_TINY
+bool append_lines(linestruct *topline, linestruct *bottomline,
+		bool continuing, bool follow);
+bool catch_up_with_file(void);
+bool input_has_arrived(int pipe);
+bool take_in_more_input(void);
+int loaded_percentage(void);
+void finish_loading(void);
+ssize_t last_line_of_hugefile(void);
+linestruct *node_in_window(ssize_t lineno);
+linestruct *move_window_to(ssize_t lineno);
+void keep_window_around_cursor(void);
+linestruct *fetch_for_search(ssize_t lineno, bool backward);
+linestruct *neighbor_in_hugefile(linestruct *line, bool backward);
+void drop_fetched_batch(void);
+void open_hugefile(FILE *f);
+#endif
 char *get_next_filename(const char *name, const char *suffix);
 void do_insertfile(void);
 #ifndef NANO_TINY
@@ -310,6 +385,7 @@ bool outside_of_confinement(const char *currpath, bool allow_tabcomp);
 void init_backup_dir(void);
 #endif
 int copy_file(FILE *inn, FILE *out, bool close_out);
+void stage_text(char *staging, const char *text, size_t count, bool decode);
 bool write_file(const char *name, FILE *thefile, writing_type method, bool annotate);
 #ifndef NANO_TINY
 bool write_region_to_file(const char *name, FILE *stream, writing_type method);
@@ -398,12 +474,34 @@ void do_scroll_right(void);
 #endif
 
 /* Most functions in nano.c. */
+#ifndef NANO_TINY
+slabstruct **list_of(slabstruct *slab);
+slabstruct *slab_of(linestruct *node);
+void hook_slab(slabstruct *slab, slabstruct **list);
+void unhook_slab(slabstruct *slab, slabstruct **list);
+linestruct *node_from_slab(void);
+void node_to_slab(linestruct *node);
+void disown_slabs(void);
+#endif
 linestruct *make_new_node(linestruct *prevnode);
+char *room_for_text(linestruct *line, size_t length);
+char *detached_text(linestruct *line);
+void remeasure(linestruct *line);
 void splice_node(linestruct *afterthis, linestruct *newnode);
 void unlink_node(linestruct *line);
 void delete_node(linestruct *line);
 linestruct *copy_buffer(const linestruct *src);
 void free_lines(linestruct *src);
+void free_buffer_lines(linestruct *src);
+ssize_t lineno_of(const linestruct *line);
+#ifndef NANO_TINY
+void drop_signposts(void);
+void index_the_lines(void);
+size_t signpost_after(ssize_t number, bool beyond);
+void reroute_signposts(ssize_t first, ssize_t last, linestruct *substitute);
+void densify_signposts(linestruct *line);
+void settle_the_numbers(ssize_t lowest);
+#endif
 void renumber_from(linestruct *line);
 void print_view_warning(void);
 bool in_restricted_mode(void);
@@ -444,6 +542,11 @@ void confirm_margin(void);
 #endif
 void unbound_key(int code);
 bool changes_something(functionptrtype f);
+#ifndef NANO_TINY
+void listen_for_Ctrl_C(bool listen);
+int background_pause(void);
+void do_background_work(void);
+#endif
 void suck_up_input_and_paste_it(void);
 void inject(char *burst, size_t count);
 
@@ -451,6 +554,7 @@ void inject(char *burst, size_t count);
 size_t get_statusbar_page_start(size_t base, size_t column);
 void put_cursor_at_end_of_answer(void);
 void add_or_remove_pipe_symbol_from_answer(void);
+void draw_the_promptbar(void);
 int do_prompt(int menu, const char *provided, linestruct **history_list,
 		void (*refresh_func)(void), const char *msg, ...);
 int ask_user(bool withall, const char *question);
@@ -481,7 +585,29 @@ void do_search_backward(void);
 void do_findprevious(void);
 void do_findnext(void);
 void not_found_msg(const char *str);
+#ifndef NANO_TINY
+const char *match_onward(const linestruct *line, const char *from,
+		bool as_regex, bool sensitively, const regex_t *regexp, size_t *length);
+size_t matches_in(const linestruct *line, size_t end);
+void count_more_matches(void);
+void start_counting_matches(bool wrapped);
+void stop_counting_matches(void);
+bool counting_matches(void);
+void start_incremental_search(void);
+void end_incremental_search(void);
+void gather_candidates_in(linestruct *line);
+void gather_candidates(clock_t deadline);
+void show_first_candidate(void);
+void search_as_typed(void);
+bool still_searching(void);
+#endif
 void go_looking(void);
+#ifndef NANO_TINY
+bool looks_behind(const char *regex);
+void collect_replacement(size_t match_len);
+void make_collected_replacements(linestruct *was_mark, bool right_side_up,
+		const linestruct *real_current, size_t *real_current_x, size_t *bot_x);
+#endif
 ssize_t do_replace_loop(const char *needle, bool whole_word_only,
 		const linestruct *real_current, size_t *real_current_x);
 void do_replace(void);
@@ -568,18 +694,34 @@ void free_chararray(char **array, size_t len);
 #ifdef ENABLE_SPELLER
 bool is_separate_word(size_t position, size_t length, const char *buf);
 #endif
-const char *strstrwrapper(const char *haystack, const char *needle,
+void sweep_for_matches(const char *haystack, size_t length, const char *regex);
+const char *last_regex_match(const char *haystack, size_t length,
+		const char *regex, size_t ceiling);
+const char *strstrwrapper(const char *haystack, size_t length, const char *needle,
 		const char *start);
 void *nmalloc(size_t howmuch);
 void *nrealloc(void *ptr, size_t howmuch);
 char *mallocstrcpy(char *dest, const char *src);
 char *measured_copy(const char *string, size_t count);
 char *copy_of(const char *string);
+#ifndef NANO_TINY
+size_t grain_slot(uintptr_t grain);
+void map_grain(uintptr_t grain, blockstruct *block);
+void unmap_grain(uintptr_t grain);
+blockstruct *new_text_block(size_t size);
+blockstruct *block_holding(const char *text);
+void release_text_block(blockstruct *block);
+#endif
+void free_text(char *text);
+char *realloc_text(char *text, size_t howmuch);
 char *free_and_assign(char *dest, char *src);
 size_t get_page_start(size_t column);
 size_t actual_x(const char *text, size_t column);
 size_t wideness(const char *text, size_t count);
 size_t breadth(const char *text);
+size_t wideness_in(const linestruct *line, size_t count);
+size_t actual_x_in(const linestruct *line, size_t column);
+size_t breadth_of(const linestruct *line);
 size_t xplustabs(void);
 void new_magicline(void);
 #if !defined(NANO_TINY) || defined(ENABLE_HELP)
@@ -619,6 +761,7 @@ void blank_it_when_expired(void);
 void set_blankdelay_to_one(void);
 char *display_string(const char *buf, size_t column, size_t span,
 						bool isdata, bool isprompt);
+char *display_line(const linestruct *line, size_t column, size_t span);
 void titlebar(const char *path);
 void minibar(void);
 void statusline(message_type importance, const char *msg, ...);
@@ -627,6 +770,14 @@ void warn_and_briefly_pause(const char *msg);
 void bottombars(int menu);
 void post_one_key(const char *keystroke, const char *tag, int width);
 void place_the_cursor(void);
+#ifdef ENABLE_COLOR
+const painttype *color_the_line(linestruct *line, size_t reach);
+#endif
+#if defined(ENABLE_COLOR) && !defined(NANO_TINY)
+linestruct *next_line_to_color(void);
+bool coloring_ahead(void);
+void color_some_lines_ahead(void);
+#endif
 int update_line(linestruct *line, size_t index);
 #ifndef NANO_TINY
 int update_softwrapped_line(linestruct *line);
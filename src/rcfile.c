@@ -95,6 +95,7 @@ static const rcoption rcopts[] = {
 	{"afterends", AFTER_ENDS},
 	{"allow_insecure_backup", INSECURE_BACKUP},
 	{"atblanks", AT_BLANKS},
+	{"atomicsave", ATOMIC_SAVE},
 	{"autoindent", AUTOINDENT},
 	{"backup", MAKE_BACKUP},
 	{"backupdir", 0},
@@ -102,7 +103,9 @@ static const rcoption rcopts[] = {
 	{"colonparsing", COLON_PARSING},
 	{"cutfromcursor", CUT_FROM_CURSOR},
 	{"emptyline", EMPTY_LINE},
+	{"follow", FOLLOW_MODE},
 	{"guidestripe", 0},
+	{"incremental", INCREMENTAL_SEARCH},
 	{"indicator", INDICATOR},
 	{"jumpyscrolling", JUMPY_SCROLLING},
 	{"locking", LOCKING},
@@ -687,6 +690,8 @@ void begin_new_syntax(char *ptr)
 #endif
 	live_syntax->color = NULL;
 	live_syntax->multiscore = 0;
+	live_syntax->sieve = NULL;
+	live_syntax->multisieve = NULL;
 
 	/* Hook the new syntax in at the top of the list. */
 	live_syntax->next = syntaxes;
@@ -1153,7 +1158,7 @@ bool parse_combination(char *combotext, short *fg, short *bg, int *attributes)
  * add a rule to the current syntax. */
 void parse_rule(char *ptr, int rex_flags)
 {
-	char *names, *regexstring;
+	char *names, *regexstring, *startstring;
 	short fg, bg;
 	int attributes;
 
@@ -1186,7 +1191,7 @@ void parse_rule(char *ptr, int rex_flags)
 			expectend = TRUE;
 		}
 
-		regexstring = ++ptr;
+		startstring = regexstring = ++ptr;
 		ptr = parse_next_regex(ptr);
 
 		/* When there is no regex, or it is invalid, skip this line. */
@@ -1217,6 +1222,8 @@ void parse_rule(char *ptr, int rex_flags)
 
 		newcolor->start = start_rgx;
 		newcolor->end = end_rgx;
+		newcolor->literals = literals_in(startstring);
+		newcolor->endliterals = (expectend) ? literals_in(regexstring) : NULL;
 
 		newcolor->fg = fg;
 		newcolor->bg = bg;
@@ -24,10 +24,78 @@
 #include <string.h>
 #include <time.h>
 
+/* The number of lines to search through between two glances at the clock. */
+#define CLOCK_CHECK_INTERVAL  1024
+
+/* The number of milliseconds that an incremental search may spend after a
+ * keystroke, and the number of matches that it gathers at most. */
+#define INCREMENTAL_BUDGET  40
+#define MAX_CANDIDATES  100000
+
 static bool came_full_circle = FALSE;
 		/* Have we reached the starting line again while searching? */
 static bool have_compiled_regexp = FALSE;
 		/* Whether we have compiled a regular expression for the search. */
+#ifndef NANO_TINY
+static linestruct *pending = NULL;
+		/* The line with replacements that were collected but not yet made. */
+static size_t *hit_x = NULL, *hit_len = NULL, *hit_piece = NULL;
+		/* Where each collected match starts, how long it is, and where
+		 * its replacement starts among the collected pieces. */
+static size_t hit_count = 0, hit_room = 0;
+		/* The number of collected matches, and for how many there is room. */
+static char *pieces = NULL;
+		/* The replacement texts for the collected matches, one after another. */
+static size_t pieces_len = 0, pieces_room = 0;
+		/* The total length of those texts, and for how much there is room. */
+static openfilestruct *counted_buffer = NULL;
+		/* The buffer whose lines hold counts of matches. */
+static char *counted_needle = NULL;
+		/* The search string for which those matches were counted. */
+static bool counted_as_regex, counted_sensitively;
+		/* Whether the string was taken as a regex, and whether case mattered. */
+static regex_t counting_regexp;
+		/* The compiled form of that string, when it is a regex. */
+static bool have_counting_regexp = FALSE;
+		/* Whether there is such a compiled regex. */
+static linestruct *tallying = NULL;
+		/* The line where the counting continues, or NULL when not counting. */
+static size_t tally, preceding;
+		/* The number of matches counted so far, and of those before the spot. */
+static linestruct *spot, *tallied_bottom;
+		/* The line of the match that was found, and the last line of the
+		 * buffer when the counting started. */
+static size_t spot_x, tallied_bottom_len;
+		/* The position of that match, and the length of that last line. */
+static bool spot_wrapped;
+		/* Whether the search had to wrap around to find that match. */
+static time_t counting_start;
+		/* When the counting began. */
+static linestruct *anchor = NULL, *was_edittop;
+		/* Where the cursor was, and the top of the window, when the user
+		 * started typing a search string. */
+static size_t anchor_x, was_firstcolumn;
+		/* The position in that line, and the leftmost column in the window. */
+static bool strayed = FALSE;
+		/* Whether the incremental search moved the cursor away from there. */
+static char *typed_needle = NULL;
+		/* The search string for which the candidates below were found. */
+static bool typed_as_regex, typed_sensitively, typed_backwards;
+		/* The search mode in which they were found. */
+static regex_t typed_regexp;
+		/* The compiled form of that string, when it is a valid regex. */
+static bool have_typed_regexp = FALSE;
+		/* Whether there is such a compiled regex. */
+static linestruct **candidate_line = NULL;
+static size_t *candidate_x = NULL, *candidate_len = NULL;
+		/* The matches found so far for the typed string, in search order. */
+static size_t candidate_count = 0, candidate_room = 0;
+		/* The number of those matches, and for how many there is room. */
+static linestruct *scanning = NULL;
+		/* The next line to look for matches in, or NULL when all were seen. */
+static bool scan_wrapped;
+		/* Whether the looking has wrapped around the end of the buffer. */
+#endif
 
 /* Compile the given regular expression and store it in search_regexp.
  * Return TRUE if the expression is valid, and FALSE otherwise. */
@@ -98,6 +166,9 @@ void search_init(bool replacing, bool retain_answer)
 
 	while (TRUE) {
 		functionptrtype function;
+#ifndef NANO_TINY
+		start_incremental_search();
+#endif
 		/* Ask the user what to search for (or replace). */
 		int response = do_prompt(
 					inhelp ? MFINDINHELP : (replacing ? MREPLACE : MWHEREIS),
@@ -114,6 +185,11 @@ void search_init(bool replacing, bool retain_answer)
 #endif
 					_(" (to replace)") : "", thedefault);
 
+#ifndef NANO_TINY
+		/* Let the actual search start from where the cursor was. */
+		end_incremental_search();
+#endif
+
 		/* If the search was cancelled, or we have a blank answer and
 		 * nothing was searched for yet during this session, get out. */
 		if (response == -1 || (response == -2 && *last_search == '\0')) {
@@ -191,6 +267,14 @@ int findnextstr(const char *needle, bool whole_word_only, int modus,
 		/* The x coordinate of a found occurrence. */
 	time_t lastkbcheck = time(NULL);
 		/* The time we last looked at the keyboard. */
+	unsigned int countdown = CLOCK_CHECK_INTERVAL;
+		/* The number of lines to search before looking at the clock again. */
+
+	/* Prepare the needle of a plain search just once, not for each line. */
+	if (!ISSET(USE_REGEXP) && ISSET(CASE_SENSITIVE))
+		prepare_for_literal_search(needle);
+	else if (!ISSET(USE_REGEXP))
+		prepare_for_caseless_search(needle);
 
 	/* Set non-blocking input so that we can just peek for a Cancel. */
 	nodelay(midwin, TRUE);
@@ -205,13 +289,13 @@ int findnextstr(const char *needle, bool whole_word_only, int modus,
 			skipone = FALSE;
 			if (ISSET(BACKWARDS_SEARCH) && from != line->data) {
 				from = line->data + step_left(line->data, from - line->data);
-				found = strstrwrapper(line->data, needle, from);
+				found = strstrwrapper(line->data, line->length, needle, from);
 			} else if (!ISSET(BACKWARDS_SEARCH) && *from) {
 				from += char_length(from);
-				found = strstrwrapper(line->data, needle, from);
+				found = strstrwrapper(line->data, line->length, needle, from);
 			}
 		} else
-			found = strstrwrapper(line->data, needle, from);
+			found = strstrwrapper(line->data, line->length, needle, from);
 
 		if (found) {
 			/* When doing a regex search, compute the length of the match. */
@@ -228,6 +312,10 @@ int findnextstr(const char *needle, bool whole_word_only, int modus,
 			/* When not on the magic line, the match is valid. */
 			if (line->next || line->data[0])
 				break;
+#ifndef NANO_TINY
+			if (openfile->hugefile && lineno_of(line) != openfile->hugefile->lastline)
+				break;
+#endif
 		}
 
 #ifndef NANO_TINY
@@ -240,12 +328,20 @@ int findnextstr(const char *needle, bool whole_word_only, int modus,
 #endif
 		/* If we're back at the beginning, then there is no needle. */
 		if (came_full_circle) {
+#ifndef NANO_TINY
+			drop_fetched_batch();
+#endif
 			nodelay(midwin, FALSE);
 			return 0;
 		}
 
 		/* Move to the previous or next line in the file. */
-		line = (ISSET(BACKWARDS_SEARCH)) ? line->prev : line->next;
+#ifndef NANO_TINY
+		if (openfile->hugefile)
+			line = neighbor_in_hugefile(line, ISSET(BACKWARDS_SEARCH));
+		else
+#endif
+			line = (ISSET(BACKWARDS_SEARCH)) ? line->prev : line->next;
 
 		/* If we've reached the start or end of the buffer, wrap around;
 		 * but stop when spell-checking or replacing in a region. */
@@ -255,6 +351,12 @@ int findnextstr(const char *needle, bool whole_word_only, int modus,
 				return 0;
 			}
 
+#ifndef NANO_TINY
+			if (openfile->hugefile)
+				line = (ISSET(BACKWARDS_SEARCH)) ? fetch_for_search(last_line_of_hugefile(), TRUE) :
+													fetch_for_search(1, FALSE);
+			else
+#endif
 			line = (ISSET(BACKWARDS_SEARCH)) ? openfile->filebot : openfile->filetop;
 
 			if (modus == JUSTFIND) {
@@ -271,9 +373,14 @@ int findnextstr(const char *needle, bool whole_word_only, int modus,
 		/* Set the starting x to the start or end of the line. */
 		from = line->data;
 		if (ISSET(BACKWARDS_SEARCH))
-			from += strlen(line->data);
+			from += line->length;
 
 		/* Glance at the keyboard once every second, to check for a Cancel. */
+		if (--countdown > 0)
+			continue;
+
+		countdown = CLOCK_CHECK_INTERVAL;
+
 		if (time(NULL) - lastkbcheck > 0) {
 			int input = wgetch(midwin);
 
@@ -298,6 +405,10 @@ int findnextstr(const char *needle, bool whole_word_only, int modus,
 					while (input != ERR)
 						input = get_input(NULL);
 					nodelay(midwin, FALSE);
+#ifndef NANO_TINY
+					if (openfile->hugefile)
+						drop_fetched_batch();
+#endif
 					return -2;
 				}
 
@@ -315,6 +426,16 @@ int findnextstr(const char *needle, bool whole_word_only, int modus,
 
 	nodelay(midwin, FALSE);
 
+#ifndef NANO_TINY
+	/* When the match lies outside of the window, move the window there. */
+	if (openfile->hugefile) {
+		if (lineno_of(line) < lineno_of(openfile->filetop) ||
+							lineno_of(line) > lineno_of(openfile->filebot))
+			line = move_window_to(lineno_of(line));
+		drop_fetched_batch();
+	}
+#endif
+
 	/* Ensure that the found occurrence is not beyond the starting x. */
 	if (came_full_circle && ((!ISSET(BACKWARDS_SEARCH) && (found_x > begin_x ||
 						(modus == REPLACING && found_x == begin_x))) ||
@@ -333,7 +454,7 @@ int findnextstr(const char *needle, bool whole_word_only, int modus,
 	if (modus == JUSTFIND && (!openfile->mark || openfile->softmark)) {
 		spotlighted = TRUE;
 		light_from_col = xplustabs();
-		light_to_col = wideness(line->data, found_x + found_len);
+		light_to_col = wideness_in(line, found_x + found_len);
 
 		/* When panning, "unpan" when the match fits within an unpanned viewport,
 		   otherwise ensure that the end of the match will be visible too. */
@@ -421,11 +542,430 @@ void not_found_msg(const char *str)
 	free(disp);
 }
 
+#ifndef NANO_TINY
+/* Return the first match in the given line at or after from, or NULL when
+ * there is none.  Use the given compiled regex when as_regex is TRUE, and
+ * else the prepared literal or caseless needle.  For a regex, set length
+ * to the length of the match. */
+const char *match_onward(const linestruct *line, const char *from,
+			bool as_regex, bool sensitively, const regex_t *regexp, size_t *length)
+{
+	if (as_regex) {
+		regmatch_t match;
+
+		match.rm_so = from - line->data;
+		match.rm_eo = line->length;
+		if (regexec(regexp, line->data, 1, &match, REG_STARTEND) != 0)
+			return NULL;
+		*length = match.rm_eo - match.rm_so;
+		return line->data + match.rm_so;
+	} else if (sensitively)
+		return find_literal(line->data, line->length, from);
+	else
+		return find_caseless(line->data, line->length, from);
+}
+
+/* Return the number of matches in the given line before position end,
+ * when stepping through them one by one with forward searches. */
+size_t matches_in(const linestruct *line, size_t end)
+{
+	const char *from = line->data;
+	const char *found;
+	size_t count = 0, length;
+
+	/* The magic line never contains a match. */
+	if (line->next == NULL && line->data[0] == '\0')
+		return 0;
+
+	while (TRUE) {
+		found = match_onward(line, from, counted_as_regex, counted_sensitively,
+										&counting_regexp, &length);
+
+		if (found == NULL || found - line->data >= end)
+			break;
+
+		count++;
+
+		if (*found == '\0')
+			break;
+
+		from = found + char_length(found);
+	}
+
+	return count;
+}
+
+/* Count the matches in the lines of the current buffer, a slice at a time,
+ * reusing the counts of lines that did not change.  When all lines have been
+ * tallied, report which match the cursor is on, and how many there are. */
+void count_more_matches(void)
+{
+	size_t budget = COUNTING_SLICE;
+
+	if (tallying == NULL || openfile != counted_buffer || openfile->loading)
+		return;
+
+	if (time(NULL) - counting_start > COUNTING_PATIENCE) {
+		tallying = NULL;
+		return;
+	}
+
+	/* When lines were added at the end of the buffer, start over. */
+	if (openfile->filebot != tallied_bottom || openfile->filebot->length != tallied_bottom_len) {
+		tallied_bottom = openfile->filebot;
+		tallied_bottom_len = openfile->filebot->length;
+		tallying = openfile->filetop;
+		tally = 0;
+	}
+
+	if (!counted_as_regex && counted_sensitively)
+		prepare_for_literal_search(counted_needle);
+	else if (!counted_as_regex)
+		prepare_for_caseless_search(counted_needle);
+
+	while (tallying && budget > 0) {
+		size_t count = tallying->hits;
+
+		/* Count the matches in a line only when they are not known. */
+		if (count >= MANY_MATCHES) {
+			count = matches_in(tallying, tallying->length + 1);
+			tallying->hits = (count < MANY_MATCHES) ? count : MANY_MATCHES;
+			budget -= (tallying->length < budget) ? tallying->length : budget;
+		}
+
+		if (tallying == spot)
+			preceding = tally + matches_in(spot, spot_x);
+
+		tally += count;
+		budget -= (budget > 16) ? 16 : budget;
+		tallying = tallying->next;
+	}
+
+	if (tallying || tally == 0)
+		return;
+
+	if (preceding >= tally)
+		preceding = tally - 1;
+
+	if (spot_wrapped)
+		statusline(REMARK, _("Search Wrapped -- match %zu of %zu"), preceding + 1, tally);
+	else
+		statusline(REMARK, _("Match %zu of %zu"), preceding + 1, tally);
+}
+
+/* Start counting the matches of the last search in the current buffer,
+ * to be able to tell the user which of them was found. */
+void start_counting_matches(bool wrapped)
+{
+	if (openfile->hugefile)
+		return;
+
+	/* When the search string or its mode changed, or the buffer, all lines
+	 * need to be counted afresh. */
+	if (openfile != counted_buffer || strcmp(counted_needle, last_search) != 0 ||
+						counted_as_regex != ISSET(USE_REGEXP) ||
+						counted_sensitively != ISSET(CASE_SENSITIVE)) {
+		if (have_counting_regexp)
+			regfree(&counting_regexp);
+
+		have_counting_regexp = (ISSET(USE_REGEXP) && regcomp(&counting_regexp, last_search,
+				NANO_REG_EXTENDED | (ISSET(CASE_SENSITIVE) ? 0 : REG_ICASE)) == 0);
+
+		if (ISSET(USE_REGEXP) && !have_counting_regexp) {
+			counted_buffer = NULL;
+			return;
+		}
+
+		counted_buffer = openfile;
+		counted_needle = mallocstrcpy(counted_needle, last_search);
+		counted_as_regex = ISSET(USE_REGEXP);
+		counted_sensitively = ISSET(CASE_SENSITIVE);
+
+		for (linestruct *line = openfile->filetop; line != NULL; line = line->next)
+			line->hits = UNCOUNTED;
+	}
+
+	spot = openfile->current;
+	spot_x = openfile->current_x;
+	spot_wrapped = wrapped;
+
+	tallied_bottom = NULL;
+	tallying = openfile->filetop;
+	preceding = 0;
+	counting_start = time(NULL);
+
+	/* Do the first slice right away, so that for a smallish buffer
+	 * the count is shown together with the found match. */
+	count_more_matches();
+}
+
+/* Abandon the counting of matches, because the user did something. */
+void stop_counting_matches(void)
+{
+	tallying = NULL;
+}
+
+/* Return TRUE when matches are still being counted. */
+bool counting_matches(void)
+{
+	return (tallying != NULL);
+}
+#endif /* !NANO_TINY */
+
+#ifndef NANO_TINY
+/* Remember where the cursor is, so that an incremental search can start from
+ * there, and so that the cursor can be put back when the search is cancelled. */
+void start_incremental_search(void)
+{
+	anchor = openfile->current;
+	anchor_x = openfile->current_x;
+	was_edittop = openfile->edittop;
+	was_firstcolumn = openfile->firstcolumn;
+	strayed = FALSE;
+
+	free(typed_needle);
+	typed_needle = NULL;
+	candidate_count = 0;
+	scanning = NULL;
+}
+
+/* Put the cursor and the viewport back where they were before the user
+ * started typing the search string, if the incremental search moved them. */
+void end_incremental_search(void)
+{
+	if (strayed) {
+		openfile->current = anchor;
+		openfile->current_x = anchor_x;
+		openfile->placewewant = xplustabs();
+		openfile->edittop = was_edittop;
+		openfile->firstcolumn = was_firstcolumn;
+		spotlighted = FALSE;
+		refresh_needed = TRUE;
+	}
+
+	if (have_typed_regexp)
+		regfree(&typed_regexp);
+	have_typed_regexp = FALSE;
+
+	anchor = NULL;
+	scanning = NULL;
+}
+
+/* Add the matches of the typed string in the given line to the candidates,
+ * in the order in which a search would find them. */
+void gather_candidates_in(linestruct *line)
+{
+	const char *from = line->data;
+	const char *found;
+	size_t first = candidate_count, length = strlen(typed_needle);
+
+	/* The magic line never contains a match. */
+	if (line->next == NULL && line->data[0] == '\0')
+		return;
+
+	while ((found = match_onward(line, from, typed_as_regex, typed_sensitively,
+											&typed_regexp, &length))) {
+		size_t x = found - line->data;
+
+		/* In the line of the cursor, take only the matches beyond it, or
+		 * (after wrapping around) only the ones before or at the cursor. */
+		if (line != anchor || (typed_backwards ? x < anchor_x : x > anchor_x) != scan_wrapped) {
+			if (candidate_count == candidate_room) {
+				candidate_room = (candidate_room == 0) ? 256 : 2 * candidate_room;
+				candidate_line = nrealloc(candidate_line, candidate_room * sizeof(linestruct *));
+				candidate_x = nrealloc(candidate_x, candidate_room * sizeof(size_t));
+				candidate_len = nrealloc(candidate_len, candidate_room * sizeof(size_t));
+			}
+
+			candidate_line[candidate_count] = line;
+			candidate_x[candidate_count] = x;
+			candidate_len[candidate_count++] = length;
+		}
+
+		if (*found == '\0')
+			break;
+
+		from = found + char_length(found);
+	}
+
+	/* When searching backwards, the last match in a line comes first. */
+	if (typed_backwards) {
+		for (size_t low = first, high = candidate_count; low + 1 < high; low++, high--) {
+			size_t x = candidate_x[low], len = candidate_len[low];
+
+			candidate_x[low] = candidate_x[high - 1];
+			candidate_len[low] = candidate_len[high - 1];
+			candidate_x[high - 1] = x;
+			candidate_len[high - 1] = len;
+		}
+	}
+}
+
+/* Look for more candidates, line after line, until the given deadline has
+ * passed, or until enough have been found, or until all lines were seen. */
+void gather_candidates(clock_t deadline)
+{
+	size_t scanned = 0;
+
+	while (scanning && candidate_count < MAX_CANDIDATES) {
+		bool last_one = (scan_wrapped && scanning == anchor);
+
+		gather_candidates_in(scanning);
+
+		if (last_one) {
+			scanning = NULL;
+			break;
+		}
+
+		scanned += scanning->length + 16;
+		scanning = (typed_backwards) ? scanning->prev : scanning->next;
+
+		/* At the end of the buffer, wrap around to the other end. */
+		if (scanning == NULL) {
+			scanning = (typed_backwards) ? openfile->filebot : openfile->filetop;
+			scan_wrapped = TRUE;
+		}
+
+		/* Glance at the clock after every stretch of text. */
+		if (scanned > 64 * 1024) {
+			if (clock() > deadline)
+				break;
+			scanned = 0;
+		}
+	}
+}
+
+/* Move the cursor to the first candidate and highlight it, or, when there
+ * is none, back to where it was when the search string was started. */
+void show_first_candidate(void)
+{
+	linestruct *was_current = openfile->current;
+
+	if (candidate_count > 0) {
+		openfile->current = candidate_line[0];
+		openfile->current_x = candidate_x[0];
+		strayed = TRUE;
+	} else {
+		openfile->current = anchor;
+		openfile->current_x = anchor_x;
+	}
+
+	spotlighted = (candidate_count > 0 && (!openfile->mark || openfile->softmark));
+
+	if (spotlighted) {
+		light_from_col = xplustabs();
+		light_to_col = wideness_in(openfile->current, openfile->current_x + candidate_len[0]);
+
+		if (united_sidescroll && light_to_col < editwincols - CUSHION)
+			openfile->brink = 0;
+		else if (united_sidescroll)
+			openfile->brink = get_page_start(light_to_col);
+	}
+
+	edit_redraw(was_current, CENTERING);
+	edit_refresh();
+}
+
+/* Move to the first match of what has been typed at the search prompt so far.
+ * When the typed string merely got longer, look for it only among the matches
+ * of the shorter string, and beyond them.  Spend at most a little time. */
+void search_as_typed(void)
+{
+	bool as_regex = ISSET(USE_REGEXP), sensitively = ISSET(CASE_SENSITIVE);
+	bool backwards = ISSET(BACKWARDS_SEARCH);
+	clock_t deadline = clock() + INCREMENTAL_BUDGET * CLOCKS_PER_SEC / 1000;
+	bool same_mode = (typed_needle && typed_as_regex == as_regex &&
+						typed_sensitively == sensitively && typed_backwards == backwards);
+	size_t typed_len = strlen(answer);
+
+	if (anchor == NULL || !ISSET(INCREMENTAL_SEARCH) || currmenu != MWHEREIS ||
+						openfile->hugefile)
+		return;
+
+	if (same_mode && strcmp(answer, typed_needle) == 0) {
+		/* When nothing changed and all lines have been seen, there is nothing to do. */
+		if (scanning == NULL)
+			return;
+	} else if (same_mode && !as_regex && *typed_needle &&
+						strncmp(answer, typed_needle, strlen(typed_needle)) == 0) {
+		size_t kept = 0;
+
+		if (sensitively)
+			prepare_for_literal_search(answer);
+		else
+			prepare_for_caseless_search(answer);
+
+		/* Keep only the candidates where also the longer string matches. */
+		for (size_t index = 0; index < candidate_count; index++) {
+			linestruct *line = candidate_line[index];
+			size_t x = candidate_x[index];
+			bool matches;
+
+			if (sensitively)
+				matches = (strncmp(line->data + x, answer, typed_len) == 0);
+			else {
+				size_t reach = x + MAXCHARLEN * typed_len;
+
+				matches = (find_caseless(line->data, (reach < line->length) ? reach : line->length,
+								line->data + x) == line->data + x);
+			}
+
+			if (matches) {
+				candidate_line[kept] = line;
+				candidate_x[kept] = x;
+				candidate_len[kept++] = typed_len;
+			}
+		}
+
+		candidate_count = kept;
+		typed_needle = mallocstrcpy(typed_needle, answer);
+	} else {
+		typed_needle = mallocstrcpy(typed_needle, answer);
+		typed_as_regex = as_regex;
+		typed_sensitively = sensitively;
+		typed_backwards = backwards;
+
+		candidate_count = 0;
+		scanning = (*answer == '\0') ? NULL : anchor;
+		scan_wrapped = FALSE;
+
+		if (have_typed_regexp)
+			regfree(&typed_regexp);
+		have_typed_regexp = FALSE;
+
+		/* An unfinished regular expression does not match anything. */
+		if (as_regex && scanning) {
+			have_typed_regexp = (regcomp(&typed_regexp, answer, NANO_REG_EXTENDED |
+									(sensitively ? 0 : REG_ICASE)) == 0);
+			if (!have_typed_regexp)
+				scanning = NULL;
+		}
+	}
+
+	if (!as_regex && sensitively)
+		prepare_for_literal_search(typed_needle);
+	else if (!as_regex)
+		prepare_for_caseless_search(typed_needle);
+
+	gather_candidates(deadline);
+
+	show_first_candidate();
+}
+
+/* Return TRUE when an incremental search has not yet looked at all lines. */
+bool still_searching(void)
+{
+	return (anchor != NULL && scanning != NULL && candidate_count < MAX_CANDIDATES &&
+				ISSET(INCREMENTAL_SEARCH) && currmenu == MWHEREIS);
+}
+#endif /* !NANO_TINY */
+
 /* Search for the global string 'last_search'.  Inform the user when
  * the string occurs only once. */
 void go_looking(void)
 {
 	linestruct *was_current = openfile->current;
+	ssize_t was_lineno = lineno_of(openfile->current);
 	size_t was_x = openfile->current_x;
 
 //#define TIMEIT  12
@@ -439,12 +979,31 @@ void go_looking(void)
 	didfind = findnextstr(last_search, FALSE, JUSTFIND, NULL, TRUE,
 								openfile->current, openfile->current_x);
 
+#ifndef NANO_TINY
+	/* When the window of a huge file was moved, the old line may be gone. */
+	if (openfile->hugefile) {
+		was_current = node_in_window(was_lineno);
+		if (was_current == NULL) {
+			adjust_viewport(CENTERING);
+			was_current = openfile->current;
+		}
+	}
+#endif
+
 	/* If we found something, and we're back at the exact same spot
 	 * where we started searching, then this is the only occurrence. */
-	if (didfind == 1 && openfile->current == was_current && openfile->current_x == was_x)
+	if (didfind == 1 && lineno_of(openfile->current) == was_lineno && openfile->current_x == was_x)
 		statusline(REMARK, _("This is the only occurrence"));
 	else if (didfind == 0)
 		not_found_msg(last_search);
+#ifndef NANO_TINY
+	else if (didfind == 1 && !inhelp)
+		start_counting_matches(ISSET(BACKWARDS_SEARCH) ?
+				(lineno_of(openfile->current) > was_lineno ||
+				(openfile->current == was_current && openfile->current_x > was_x)) :
+				(lineno_of(openfile->current) < was_lineno ||
+				(openfile->current == was_current && openfile->current_x < was_x)));
+#endif
 
 #ifdef TIMEIT
 	statusline(NOTICE, "Took: %.2f", (double)(clock() - start) / CLOCKS_PER_SEC);
@@ -492,7 +1051,7 @@ int replace_regexp(char *string)
 /* Return a copy of the current line with one needle replaced. */
 char *replace_line(const char *needle)
 {
-	size_t new_size = strlen(openfile->current->data) + 1;
+	size_t new_size = openfile->current->length + 1;
 	size_t match_len;
 	char *copy;
 
@@ -522,6 +1081,132 @@ char *replace_line(const char *needle)
 	return copy;
 }
 
+#ifndef NANO_TINY
+/* Return TRUE when the given regex contains an anchor that looks at the text
+ * before a match (^, \b, \B, \<, \>, or \`), which a replacement can change.
+ * A caret right after an opening bracket just negates a bracket expression. */
+bool looks_behind(const char *regex)
+{
+	for (const char *spot = regex; *spot; spot++) {
+		if (*spot == '^' && (spot == regex || spot[-1] != '['))
+			return TRUE;
+		if (*spot == '\\' && spot[1]) {
+			if (strchr("bB<>`", *++spot))
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/* Note the match at the cursor and the text that should replace it, so that
+ * all replacements in the current line can later be made in one go. */
+void collect_replacement(size_t match_len)
+{
+	size_t size = (ISSET(USE_REGEXP) ? replace_regexp(NULL) : strlen(answer));
+
+	if (hit_count == hit_room) {
+		hit_room = (hit_room == 0) ? 64 : 2 * hit_room;
+		hit_x = nrealloc(hit_x, hit_room * sizeof(size_t));
+		hit_len = nrealloc(hit_len, hit_room * sizeof(size_t));
+		hit_piece = nrealloc(hit_piece, hit_room * sizeof(size_t));
+	}
+
+	if (pieces_len + size + 1 > pieces_room) {
+		pieces_room = 2 * (pieces_len + size + 1);
+		pieces = nrealloc(pieces, pieces_room);
+	}
+
+	if (ISSET(USE_REGEXP))
+		replace_regexp(pieces + pieces_len);
+	else
+		strcpy(pieces + pieces_len, answer);
+
+	hit_x[hit_count] = openfile->current_x;
+	hit_len[hit_count] = match_len;
+	hit_piece[hit_count++] = pieces_len;
+	pieces_len += size;
+
+	pending = openfile->current;
+}
+
+/* Rewrite the pending line in one go with all the replacements that were
+ * collected for it, and save its original text in the undo item.  Adjust
+ * the mark or the real cursor position, and the end of the region, for
+ * the changes, in the same way as when replacing one match at a time. */
+void make_collected_replacements(linestruct *was_mark, bool right_side_up,
+		const linestruct *real_current, size_t *real_current_x, size_t *bot_x)
+{
+	size_t new_len = pending->length, shift = 0, from = 0;
+	char *original = pending->data;
+	char *altered, *spot;
+
+	for (size_t index = 0; index < hit_count; index++) {
+		size_t piece_end = (index + 1 < hit_count) ? hit_piece[index + 1] : pieces_len;
+		size_t length_change = piece_end - hit_piece[index] - hit_len[index];
+		size_t x = hit_x[index] + shift;
+
+		new_len += length_change;
+		shift += length_change;
+
+		/* Each match adjusts the positions as if the earlier ones (to its left)
+		 * were already replaced. */
+		if (was_mark && !right_side_up) {
+			if (pending == was_mark && openfile->mark_x > x) {
+				if (openfile->mark_x < x + hit_len[index])
+					openfile->mark_x = x;
+				else
+					openfile->mark_x += length_change;
+				*bot_x = openfile->mark_x;
+			}
+		}
+
+		if ((!was_mark || right_side_up) && pending == real_current && x < *real_current_x) {
+			if (*real_current_x < x + hit_len[index])
+				*real_current_x = x + hit_len[index];
+			*real_current_x += length_change;
+			*bot_x = *real_current_x;
+		}
+	}
+
+	altered = nmalloc(new_len + 1);
+	spot = altered;
+
+	/* Copy the unchanged parts and the replacements, from left to right. */
+	for (size_t index = 0; index < hit_count; index++) {
+		size_t piece_end = (index + 1 < hit_count) ? hit_piece[index + 1] : pieces_len;
+
+		memcpy(spot, original + from, hit_x[index] - from);
+		spot += hit_x[index] - from;
+		memcpy(spot, pieces + hit_piece[index], piece_end - hit_piece[index]);
+		spot += piece_end - hit_piece[index];
+		from = hit_x[index] + hit_len[index];
+	}
+
+	strcpy(spot, original + from);
+
+	/* Update the file size, and put the changed line into place. */
+	openfile->totsize -= pending->chars;
+	pending->data = altered;
+	remeasure(pending);
+	openfile->totsize += pending->chars;
+
+	update_multiline_undo(lineno_of(pending), original);
+	free_text(original);
+
+#ifdef ENABLE_COLOR
+	check_the_multis(pending);
+	refresh_needed = FALSE;
+#endif
+	set_modified();
+	as_an_at = TRUE;
+
+	pending = NULL;
+	hit_count = 0;
+	pieces_len = 0;
+}
+#endif /* !NANO_TINY */
+
 /* Step through each occurrence of the search string and prompt the user
  * before replacing it.  We seek for needle, and replace it with answer.
  * The parameters real_current and real_current_x are needed in order to
@@ -539,8 +1224,15 @@ ssize_t do_replace_loop(const char *needle, bool whole_word_only,
 #ifndef NANO_TINY
 	linestruct *was_mark = openfile->mark;
 	linestruct *top, *bot;
-	size_t top_x, bot_x;
+	size_t top_x, bot_x = 0;
 	bool right_side_up = (openfile->mark && mark_is_before_cursor());
+	bool collecting = FALSE;
+	/* Replacements can be collected and made in one go only when each match
+	 * is found in the original line just as in the partly replaced one: when
+	 * searching forward (as backward a match may run into a replacement), and
+	 * when nothing before a match matters (no anchors, no whole words). */
+	bool batchable = (!ISSET(BACKWARDS_SEARCH) && !whole_word_only &&
+						!(ISSET(USE_REGEXP) && looks_behind(needle)));
 
 	/* If the mark is on, frame the region, and turn the mark off. */
 	if (openfile->mark) {
@@ -566,6 +1258,27 @@ ssize_t do_replace_loop(const char *needle, bool whole_word_only,
 		int result = findnextstr(needle, whole_word_only, modus,
 						&match_len, skipone, real_current, *real_current_x);
 
+#ifndef NANO_TINY
+		/* When the search has left the line with collected replacements,
+		 * or has ended, make these replacements.  When it found a match in
+		 * this line that does not lie beyond the collected ones (because it
+		 * wrapped around), make the replacements and search the changed line
+		 * again from its start. */
+		if (pending && result > 0 && openfile->current == pending) {
+			size_t last = hit_count - 1;
+
+			if (openfile->current_x < hit_x[last] + hit_len[last] ||
+						(hit_len[last] == 0 && openfile->current_x == hit_x[last])) {
+				make_collected_replacements(was_mark, right_side_up,
+										real_current, real_current_x, &bot_x);
+				openfile->current_x = 0;
+				skipone = FALSE;
+				continue;
+			}
+		} else if (pending)
+			make_collected_replacements(was_mark, right_side_up,
+										real_current, real_current_x, &bot_x);
+#endif
 		/* If nothing more was found, or the user aborted, stop looping. */
 		if (result < 1) {
 			if (result < 0)
@@ -575,8 +1288,8 @@ ssize_t do_replace_loop(const char *needle, bool whole_word_only,
 
 #ifndef NANO_TINY
 		/* An occurrence outside of the marked region means we're done. */
-		if (was_mark && (openfile->current->lineno > bot->lineno ||
-								openfile->current->lineno < top->lineno ||
+		if (was_mark && (lineno_of(openfile->current) > lineno_of(bot) ||
+								lineno_of(openfile->current) < lineno_of(top) ||
 								(openfile->current == bot &&
 								openfile->current_x + match_len > bot_x) ||
 								(openfile->current == top &&
@@ -591,7 +1304,7 @@ ssize_t do_replace_loop(const char *needle, bool whole_word_only,
 		if (!replaceall) {
 			spotlighted = TRUE;
 			light_from_col = xplustabs();
-			light_to_col = wideness(openfile->current->data, openfile->current_x + match_len);
+			light_to_col = wideness_in(openfile->current, openfile->current_x + match_len);
 #ifndef NANO_TINY
 			if (united_sidescroll && light_to_col < editwincols - CUSHION)
 				openfile->brink = 0;
@@ -616,13 +1329,35 @@ ssize_t do_replace_loop(const char *needle, bool whole_word_only,
 			skipone = (choice == 0 || ISSET(BACKWARDS_SEARCH));
 		}
 
+#ifndef NANO_TINY
+		/* When replacing all, do not change the line for each match; collect
+		 * the replacements, so that the line can be rewritten just once, and
+		 * so that a single undo item covers the whole operation. */
+		if (replaceall && batchable) {
+			if (!collecting)
+				add_undo(REPLACE_ALL, NULL);
+			collecting = TRUE;
+
+			collect_replacement(match_len);
+
+			/* Don't find the same zero-length match again. */
+			if (match_len == 0)
+				skipone = TRUE;
+
+			/* Continue searching after the match. */
+			openfile->current_x += match_len;
+
+			numreplaced++;
+			continue;
+		}
+#endif
 		if (choice == YES || replaceall) {
 			size_t length_change;
 			char *altered;
 
 			altered = replace_line(needle);
 
-			length_change = strlen(altered) - strlen(openfile->current->data);
+			length_change = strlen(altered) - openfile->current->length;
 
 #ifndef NANO_TINY
 			add_undo(REPLACE, NULL);
@@ -666,9 +1401,11 @@ ssize_t do_replace_loop(const char *needle, bool whole_word_only,
 				openfile->current_x += match_len + length_change;
 
 			/* Update the file size, and put the changed line into place. */
-			openfile->totsize += mbstrlen(altered) - mbstrlen(openfile->current->data);
-			free(openfile->current->data);
+			openfile->totsize -= openfile->current->chars;
+			free_text(openfile->current->data);
 			openfile->current->data = altered;
+			remeasure(openfile->current);
+			openfile->totsize += openfile->current->chars;
 
 #ifdef ENABLE_COLOR
 			check_the_multis(openfile->current);
@@ -680,6 +1417,14 @@ ssize_t do_replace_loop(const char *needle, bool whole_word_only,
 		}
 	}
 
+#ifndef NANO_TINY
+	/* When the loop ended at the edge of the region, some replacements
+	 * may still need to be made. */
+	if (pending)
+		make_collected_replacements(was_mark, right_side_up,
+										real_current, real_current_x, &bot_x);
+#endif
+
 	if (numreplaced == -1)
 		not_found_msg(needle);
 
@@ -752,12 +1497,17 @@ void ask_for_and_do_replacements(void)
 void goto_line_posx(ssize_t linenumber, size_t pos_x)
 {
 #ifdef ENABLE_COLOR
-	if (linenumber > openfile->edittop->lineno + editwinrows ||
-				(ISSET(SOFTWRAP) && linenumber > openfile->current->lineno))
+	if (linenumber > lineno_of(openfile->edittop) + editwinrows ||
+				(ISSET(SOFTWRAP) && linenumber > lineno_of(openfile->current)))
 		recook |= perturbed;
 #endif
 
-	if (linenumber < openfile->filebot->lineno)
+#ifndef NANO_TINY
+	if (openfile->hugefile)
+		openfile->current = move_window_to(linenumber);
+	else
+#endif
+	if (linenumber < lineno_of(openfile->filebot))
 		openfile->current = line_from_number(linenumber);
 	else
 		openfile->current = openfile->filebot;
@@ -778,7 +1528,7 @@ void do_gotolinecolumn(void)
 /* Ask for a line and maybe column number, and then jump there. */
 void ask_for_line_and_column(char *provided)
 {
-	ssize_t line = openfile->current->lineno;
+	ssize_t line = lineno_of(openfile->current);
 	ssize_t column = openfile->placewewant + 1;
 	int response = do_prompt(MGOTOLINE, provided, NULL, edit_refresh,
 					/* TRANSLATORS: This is a prompt. */
@@ -803,7 +1553,7 @@ void ask_for_line_and_column(char *provided)
 	}
 
 	if (doublesign)
-		line += openfile->current->lineno;
+		line += lineno_of(openfile->current);
 	if (doublesign && line < 1)
 		line = 1;
 
@@ -818,41 +1568,61 @@ void goto_line_and_column(ssize_t line, ssize_t column, bool hugfloor)
 {
 	int rows_from_tail;
 
+#ifndef NANO_TINY
+	/* When the line might lie beyond what was loaded so far, load the rest. */
+	if (openfile->loading && (line < 0 || line >= lineno_of(openfile->filebot)))
+		finish_loading();
+#endif
+
 	/* Take a negative line number to mean: from the end of the file. */
-	if (line < 0)
-		line = openfile->filebot->lineno + line + 1;
-	else if (line == 0)
-		line = openfile->current->lineno;
+	if (line < 0) {
+#ifndef NANO_TINY
+		if (openfile->hugefile)
+			line = last_line_of_hugefile() + line + 1;
+		else
+#endif
+		line = lineno_of(openfile->filebot) + line + 1;
+	} else if (line == 0)
+		line = lineno_of(openfile->current);
 	if (line < 1)
 		line = 1;
 
 #ifdef ENABLE_COLOR
-	if (line > openfile->edittop->lineno + editwinrows ||
-				(ISSET(SOFTWRAP) && line > openfile->current->lineno))
+	if (line > lineno_of(openfile->edittop) + editwinrows ||
+				(ISSET(SOFTWRAP) && line > lineno_of(openfile->current)))
 		recook |= perturbed;
 #endif
 
+#ifndef NANO_TINY
+	if (openfile->hugefile)
+		openfile->current = move_window_to(line);
+	else if (line < lineno_of(openfile->filebot))
+		openfile->current = line_from_number(line);
+	else
+		openfile->current = openfile->filebot;
+#else
 	/* Iterate to the requested line. */
 	for (openfile->current = openfile->filetop; line > 1 &&
 				openfile->current != openfile->filebot; line--)
 		openfile->current = openfile->current->next;
+#endif
 
 	/* Take a negative column number to mean: from the end of the line. */
 	if (column < 0)
-		column = breadth(openfile->current->data) + column + 2;
+		column = breadth_of(openfile->current) + column + 2;
 	else if (column == 0)
 		column = openfile->placewewant + 1;
 	if (column < 1)
 		column = 1;
 
 	/* Set the x position that corresponds to the requested column. */
-	openfile->current_x = actual_x(openfile->current->data, column - 1);
+	openfile->current_x = actual_x_in(openfile->current, column - 1);
 	openfile->placewewant = column - 1;
 
 #ifndef NANO_TINY
 	if (ISSET(SOFTWRAP) && openfile->placewewant / editwincols >
-						breadth(openfile->current->data) / editwincols)
-		openfile->placewewant = breadth(openfile->current->data);
+						breadth_of(openfile->current) / editwincols)
+		openfile->placewewant = breadth_of(openfile->current);
 #endif
 
 	if (!hugfloor)
@@ -867,7 +1637,7 @@ void goto_line_and_column(ssize_t line, ssize_t column, bool hugfloor)
 							editwinrows / 2, &currentline, &leftedge);
 	} else
 #endif
-		rows_from_tail = openfile->filebot->lineno - openfile->current->lineno;
+		rows_from_tail = lineno_of(openfile->filebot) - lineno_of(openfile->current);
 
 	/* If the target line is close to the tail of the file, put the last
 	 * line or chunk on the bottom line of the screen; otherwise, just
@@ -894,7 +1664,7 @@ bool find_a_bracket(bool reverse, const char *bracket_pair)
 			line = line->prev;
 			if (line == NULL)
 				return FALSE;
-			pointer = line->data + strlen(line->data);
+			pointer = line->data + line->length;
 		} else
 			pointer = line->data + step_left(line->data, openfile->current_x);
 
@@ -903,7 +1673,7 @@ bool find_a_bracket(bool reverse, const char *bracket_pair)
 			line = line->prev;
 			if (line == NULL)
 				return FALSE;
-			pointer = line->data + strlen(line->data);
+			pointer = line->data + line->length;
 		}
 	} else {
 		pointer = line->data + step_right(line->data, openfile->current_x);
@@ -1028,8 +1798,8 @@ void go_to_and_confirm(linestruct *line)
 		openfile->current = line;
 		openfile->current_x = 0;
 #ifdef ENABLE_COLOR
-		if (line->lineno > openfile->edittop->lineno + editwinrows ||
-					(ISSET(SOFTWRAP) && line->lineno > was_current->lineno))
+		if (lineno_of(line) > lineno_of(openfile->edittop) + editwinrows ||
+					(ISSET(SOFTWRAP) && lineno_of(line) > lineno_of(was_current)))
 			recook |= perturbed;
 #endif
 		edit_redraw(was_current, CENTERING);
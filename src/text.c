@@ -84,7 +84,7 @@ void do_tab(void)
 /* Add an indent to the given line. */
 void indent_a_line(linestruct *line, char *indentation)
 {
-	size_t length = strlen(line->data);
+	size_t length = line->length;
 	size_t indent_len = strlen(indentation);
 
 	/* If the requested indentation is empty, don't change the line. */
@@ -92,9 +92,10 @@ void indent_a_line(linestruct *line, char *indentation)
 		return;
 
 	/* Add the fabricated indentation to the beginning of the line. */
-	line->data = nrealloc(line->data, length + indent_len + 1);
+	line->data = realloc_text(line->data, length + indent_len + 1);
 	memmove(line->data + indent_len, line->data, length + 1);
 	memcpy(line->data, indentation, indent_len);
+	remeasure(line);
 
 	openfile->totsize += indent_len;
 
@@ -150,7 +151,7 @@ void do_indent(void)
 		char *real_indent = (line->data[0] == '\0') ? "" : indentation;
 
 		indent_a_line(line, real_indent);
-		update_multiline_undo(line->lineno, real_indent);
+		update_multiline_undo(lineno_of(line), real_indent);
 	}
 
 	free(indentation);
@@ -215,7 +216,7 @@ void compensate_leftward(linestruct *line, size_t leftshift)
 /* Remove an indent from the given line. */
 void unindent_a_line(linestruct *line, size_t indent_len)
 {
-	size_t length = strlen(line->data);
+	size_t length = line->length;
 
 	/* If the indent is empty, don't change the line. */
 	if (indent_len == 0)
@@ -223,6 +224,7 @@ void unindent_a_line(linestruct *line, size_t indent_len)
 
 	/* Remove the first tab's worth of whitespace from this line. */
 	memmove(line->data, line->data + indent_len, length - indent_len + 1);
+	remeasure(line);
 
 	openfile->totsize -= indent_len;
 
@@ -256,7 +258,7 @@ void do_unindent(void)
 		char *indentation = measured_copy(line->data, indent_len);
 
 		unindent_a_line(line, indent_len);
-		update_multiline_undo(line->lineno, indentation);
+		update_multiline_undo(lineno_of(line), indentation);
 
 		free(indentation);
 	}
@@ -278,8 +280,8 @@ void handle_indent_action(undostruct *u, bool undoing, bool add_indent)
 		goto_line_posx(u->head_lineno, u->head_x);
 
 	/* For each line in the group, add or remove the individual indent. */
-	while (line && line->lineno <= group->bottom_line) {
-		char *blanks = group->indentations[line->lineno - group->top_line];
+	while (line && lineno_of(line) <= group->bottom_line) {
+		char *blanks = group->indentations[lineno_of(line) - group->top_line];
 
 		if (undoing ^ add_indent)
 			indent_a_line(line, blanks);
@@ -295,6 +297,46 @@ void handle_indent_action(undostruct *u, bool undoing, bool add_indent)
 
 	refresh_needed = TRUE;
 }
+
+/* Exchange the text of each line that was changed by a replace-all with the
+ * text that was saved for it.  When undoing, go through the changed lines in
+ * reverse order, and when redoing, in the original order, so that a line that
+ * was changed twice (when the search wrapped around) gets the right text. */
+void exchange_replaced_lines(undostruct *u, bool undoing)
+{
+	groupstruct **groups = NULL;
+	groupstruct *group;
+	size_t count = 0, room = 0;
+
+	for (group = u->grouping; group != NULL; group = group->next) {
+		if (count == room) {
+			room = (room == 0) ? 64 : 2 * room;
+			groups = nrealloc(groups, room * sizeof(groupstruct *));
+		}
+		groups[count++] = group;
+	}
+
+	for (size_t index = 0; index < count; index++) {
+		linestruct *line;
+
+		group = groups[undoing ? index : count - 1 - index];
+		line = line_from_number(group->top_line);
+
+		for (ssize_t number = group->top_line; number <= group->bottom_line; number++) {
+			char *data = group->indentations[number - group->top_line];
+
+			group->indentations[number - group->top_line] = detached_text(line);
+			line->data = data;
+			remeasure(line);
+			line = line->next;
+		}
+	}
+
+	free(groups);
+
+	goto_line_posx(u->head_lineno, u->head_x);
+	refresh_needed = TRUE;
+}
 #endif /* !NANO_TINY */
 
 #ifdef ENABLE_COMMENT
@@ -310,7 +352,7 @@ bool comment_line(undo_type action, linestruct *line, const char *comment_seq)
 		/* Length of prefix. */
 	size_t post_len = post_seq ? comment_seq_len - pre_len - 1 : 0;
 		/* Length of postfix. */
-	size_t line_len = strlen(line->data);
+	size_t line_len = line->length;
 
 	if (!ISSET(NO_NEWLINES) && line == openfile->filebot)
 		return FALSE;
@@ -318,11 +360,12 @@ bool comment_line(undo_type action, linestruct *line, const char *comment_seq)
 	if (action == COMMENT) {
 		/* Make room for the comment sequence(s), move the text right and
 		 * copy them in. */
-		line->data = nrealloc(line->data, line_len + pre_len + post_len + 1);
+		line->data = realloc_text(line->data, line_len + pre_len + post_len + 1);
 		memmove(line->data + pre_len, line->data, line_len + 1);
 		memmove(line->data, comment_seq, pre_len);
 		if (post_len > 0)
 			memmove(line->data + pre_len + line_len, post_seq, post_len + 1);
+		remeasure(line);
 
 		openfile->totsize += pre_len + post_len;
 
@@ -348,6 +391,7 @@ bool comment_line(undo_type action, linestruct *line, const char *comment_seq)
 		memmove(line->data, line->data + pre_len, line_len - pre_len);
 		/* Truncate the postfix if there was one. */
 		line->data[line_len - pre_len - post_len] = '\0';
+		remeasure(line);
 
 		openfile->totsize -= pre_len + post_len;
 
@@ -412,7 +456,7 @@ void do_comment(void)
 	 * store undo data when a line changed. */
 	for (line = top; line != bot->next; line = line->next)
 		if (comment_line(action, line, comment_seq))
-			update_multiline_undo(line->lineno, "");
+			update_multiline_undo(lineno_of(line), "");
 
 	set_modified();
 	ensure_firstcolumn_is_aligned();
@@ -432,7 +476,7 @@ void handle_comment_action(undostruct *u, bool undoing, bool add_comment)
 	while (group) {
 		linestruct *line = line_from_number(group->top_line);
 
-		while (line && line->lineno <= group->bottom_line) {
+		while (line && lineno_of(line) <= group->bottom_line) {
 			comment_line(undoing ^ add_comment ? COMMENT : UNCOMMENT, line, u->strdata);
 			line = line->next;
 		}
@@ -519,6 +563,7 @@ void do_undo(void)
 			remove_magicline();
 		memmove(line->data + u->head_x, line->data + u->head_x + strlen(u->strdata),
 						strlen(line->data + u->head_x) - strlen(u->strdata) + 1);
+		remeasure(line);
 		goto_line_posx(u->head_lineno, u->head_x);
 		break;
 	case ENTER:
@@ -528,9 +573,10 @@ void do_undo(void)
 		 * case, adjust the positions to return to and to scoop data from. */
 		original_x = (u->head_x == 0) ? u->tail_x : u->head_x;
 		regain_from_x = (u->head_x == 0) ? 0 : u->tail_x;
-		line->data = nrealloc(line->data, strlen(line->data) +
+		line->data = realloc_text(line->data, line->length +
 								strlen(&u->strdata[regain_from_x]) + 1);
-		strcat(line->data, &u->strdata[regain_from_x]);
+		strcpy(line->data + line->length, &u->strdata[regain_from_x]);
+		remeasure(line);
 		line->has_anchor |= line->next->has_anchor;
 		unlink_node(line->next);
 		renumber_from(line);
@@ -540,12 +586,13 @@ void do_undo(void)
 	case BACK:
 	case DEL:
 		undidmsg = _("deletion");
-		data = nmalloc(strlen(line->data) + strlen(u->strdata) + 1);
+		data = nmalloc(line->length + strlen(u->strdata) + 1);
 		strncpy(data, line->data, u->head_x);
 		strcpy(&data[u->head_x], u->strdata);
 		strcpy(&data[u->head_x + strlen(u->strdata)], &line->data[u->head_x]);
-		free(line->data);
+		free_text(line->data);
 		line->data = data;
+		remeasure(line);
 		goto_line_posx(u->tail_lineno, u->tail_x);
 		break;
 	case JOIN:
@@ -554,13 +601,15 @@ void do_undo(void)
 		 * and the nonewlines flag isn't set, do not re-add a newline that
 		 * wasn't actually deleted; just position the cursor. */
 		if ((u->xflags & WAS_BACKSPACE_AT_EOF) && !ISSET(NO_NEWLINES)) {
-	        goto_line_posx(openfile->filebot->lineno, 0);
+	        goto_line_posx(lineno_of(openfile->filebot), 0);
 			focusing = FALSE;
 			break;
 		}
 		line->data[u->tail_x] = '\0';
+		remeasure(line);
 		intruder = make_new_node(line);
 		intruder->data = copy_of(u->strdata);
+		remeasure(intruder);
 		splice_node(line, intruder);
 		renumber_from(intruder);
 		goto_line_posx(u->head_lineno, u->head_x);
@@ -568,8 +617,9 @@ void do_undo(void)
 	case REPLACE:
 		undidmsg = _("replacement");
 		data = u->strdata;
-		u->strdata = line->data;
+		u->strdata = detached_text(line);
 		line->data = data;
+		remeasure(line);
 		goto_line_posx(u->head_lineno, u->head_x);
 		break;
 #ifdef ENABLE_WRAPPING
@@ -636,6 +686,10 @@ void do_undo(void)
 		handle_indent_action(u, TRUE, FALSE);
 		undidmsg = _("unindent");
 		break;
+	case REPLACE_ALL:
+		exchange_replaced_lines(u, TRUE);
+		undidmsg = _("replacement");
+		break;
 #ifdef ENABLE_COMMENT
 	case COMMENT:
 		handle_comment_action(u, TRUE, TRUE);
@@ -663,7 +717,7 @@ void do_undo(void)
 #ifdef ENABLE_COLOR
 	if (u->type <= REPLACE)
 		check_the_multis(openfile->current);
-	else if (u->type == INSERT || u->type == COUPLE_BEGIN)
+	else if (u->type == INSERT || u->type == COUPLE_BEGIN || u->type == REPLACE_ALL)
 		recook = TRUE;
 #endif
 
@@ -702,19 +756,22 @@ void do_redo(void)
 		redidmsg = _("addition");
 		if ((u->xflags & INCLUDED_LAST_LINE) && !ISSET(NO_NEWLINES))
 			new_magicline();
-		data = nmalloc(strlen(line->data) + strlen(u->strdata) + 1);
+		data = nmalloc(line->length + strlen(u->strdata) + 1);
 		strncpy(data, line->data, u->head_x);
 		strcpy(&data[u->head_x], u->strdata);
 		strcpy(&data[u->head_x + strlen(u->strdata)], &line->data[u->head_x]);
-		free(line->data);
+		free_text(line->data);
 		line->data = data;
+		remeasure(line);
 		goto_line_posx(u->tail_lineno, u->tail_x);
 		break;
 	case ENTER:
 		redidmsg = _("line break");
 		line->data[u->head_x] = '\0';
+		remeasure(line);
 		intruder = make_new_node(line);
 		intruder->data = copy_of(u->strdata);
+		remeasure(intruder);
 		splice_node(line, intruder);
 		renumber_from(intruder);
 		goto_line_posx(u->head_lineno + 1, u->tail_x);
@@ -724,6 +781,7 @@ void do_redo(void)
 		redidmsg = _("deletion");
 		memmove(line->data + u->head_x, line->data + u->head_x + strlen(u->strdata),
 						strlen(line->data + u->head_x) - strlen(u->strdata) + 1);
+		remeasure(line);
 		goto_line_posx(u->head_lineno, u->head_x);
 		break;
 	case JOIN:
@@ -735,8 +793,9 @@ void do_redo(void)
 			goto_line_posx(u->tail_lineno, u->tail_x);
 			break;
 		}
-		line->data = nrealloc(line->data, strlen(line->data) + strlen(u->strdata) + 1);
-		strcat(line->data, u->strdata);
+		line->data = realloc_text(line->data, line->length + strlen(u->strdata) + 1);
+		strcpy(line->data + line->length, u->strdata);
+		remeasure(line);
 		unlink_node(line->next);
 		renumber_from(line);
 		openfile->current = line;
@@ -745,8 +804,9 @@ void do_redo(void)
 	case REPLACE:
 		redidmsg = _("replacement");
 		data = u->strdata;
-		u->strdata = line->data;
+		u->strdata = detached_text(line);
 		line->data = data;
+		remeasure(line);
 		goto_line_posx(u->head_lineno, u->head_x);
 		break;
 #ifdef ENABLE_WRAPPING
@@ -805,6 +865,10 @@ void do_redo(void)
 		handle_indent_action(u, FALSE, FALSE);
 		redidmsg = _("unindent");
 		break;
+	case REPLACE_ALL:
+		exchange_replaced_lines(u, FALSE);
+		redidmsg = _("replacement");
+		break;
 #ifdef ENABLE_COMMENT
 	case COMMENT:
 		handle_comment_action(u, FALSE, TRUE);
@@ -832,7 +896,7 @@ void do_redo(void)
 #ifdef ENABLE_COLOR
 	if (u->type <= REPLACE)
 		check_the_multis(openfile->current);
-	else if (u->type == INSERT || u->type == COUPLE_END)
+	else if (u->type == INSERT || u->type == COUPLE_END || u->type == REPLACE_ALL)
 		recook = TRUE;
 #endif
 
@@ -872,7 +936,7 @@ void do_enter(void)
 	}
 #endif /* NANO_TINY */
 
-	newnode->data = nmalloc(strlen(openfile->current->data + openfile->current_x) + extra + 1);
+	newnode->data = room_for_text(newnode, openfile->current->length - openfile->current_x + extra);
 	strcpy(&newnode->data[extra], openfile->current->data + openfile->current_x);
 
 #ifndef NANO_TINY
@@ -893,8 +957,11 @@ void do_enter(void)
 	}
 #endif
 
+	remeasure(newnode);
+
 	/* Make the current line end at the cursor position. */
 	openfile->current->data[openfile->current_x] = '\0';
+	remeasure(openfile->current);
 
 #ifndef NANO_TINY
 	add_undo(ENTER, NULL);
@@ -931,7 +998,7 @@ void discard_until(const undostruct *thisitem)
 
 	while (dropit && dropit != thisitem) {
 		openfile->undotop = dropit->next;
-		free(dropit->strdata);
+		free_text(dropit->strdata);
 		free_lines(dropit->cutbuffer);
 		group = dropit->grouping;
 		while (group) {
@@ -961,9 +1028,9 @@ void add_undo(undo_type action, const char *message)
 	u->type = action;
 	u->strdata = NULL;
 	u->cutbuffer = NULL;
-	u->head_lineno = thisline->lineno;
+	u->head_lineno = lineno_of(thisline);
 	u->head_x = openfile->current_x;
-	u->tail_lineno = thisline->lineno;
+	u->tail_lineno = lineno_of(thisline);
 	u->tail_x = openfile->current_x;
 	u->wassize = openfile->totsize;
 	u->newsize = openfile->totsize;
@@ -1019,7 +1086,7 @@ void add_undo(undo_type action, const char *message)
 		action = JOIN;
 		if (thisline->next) {
 			if (u->type == BACK) {
-				u->head_lineno = thisline->next->lineno;
+				u->head_lineno = lineno_of(thisline->next);
 				u->head_x = 0;
 			}
 			u->strdata = copy_of(thisline->next->data);
@@ -1043,15 +1110,15 @@ void add_undo(undo_type action, const char *message)
 	case CUT:
 		if (openfile->mark) {
 			if (mark_is_before_cursor()){
-				u->head_lineno = openfile->mark->lineno;
+				u->head_lineno = lineno_of(openfile->mark);
 				u->head_x = openfile->mark_x;
 				u->xflags |= MARK_WAS_SET;
 			} else {
-				u->tail_lineno = openfile->mark->lineno;
+				u->tail_lineno = lineno_of(openfile->mark);
 				u->tail_x = openfile->mark_x;
 				u->xflags |= (MARK_WAS_SET | CURSOR_WAS_AT_HEAD);
 			}
-			if (u->tail_lineno == openfile->filebot->lineno)
+			if (u->tail_lineno == lineno_of(openfile->filebot))
 				u->xflags |= INCLUDED_LAST_LINE;
 		} else if (!ISSET(CUT_FROM_CURSOR)) {
 			/* The entire line is being cut regardless of the cursor position. */
@@ -1078,6 +1145,7 @@ void add_undo(undo_type action, const char *message)
 		break;
 	case INDENT:
 	case UNINDENT:
+	case REPLACE_ALL:
 #ifdef ENABLE_COMMENT
 	case COMMENT:
 	case UNCOMMENT:
@@ -1199,11 +1267,11 @@ void update_undo(undo_type action)
 			}
 			u->tail_lineno = u->head_lineno + count;
 			if (ISSET(CUT_FROM_CURSOR) || u->type == CUT_TO_EOF) {
-				u->tail_x = strlen(bottomline->data);
+				u->tail_x = bottomline->length;
 				if (count == 0)
 					u->tail_x += u->head_x;
 			} else if (openfile->current == openfile->filebot && ISSET(NO_NEWLINES))
-				u->tail_x = strlen(bottomline->data);
+				u->tail_x = bottomline->length;
 		}
 		break;
 	case COUPLE_BEGIN:
@@ -1211,7 +1279,7 @@ void update_undo(undo_type action)
 	case COUPLE_END:
 	case PASTE:
 	case INSERT:
-		u->tail_lineno = openfile->current->lineno;
+		u->tail_lineno = lineno_of(openfile->current);
 		u->tail_x = openfile->current_x;
 		break;
 	default:
@@ -1228,7 +1296,7 @@ void do_wrap(void)
 {
 	linestruct *line = openfile->current;
 		/* The line to be wrapped, if needed and possible. */
-	size_t line_len = strlen(line->data);
+	size_t line_len = line->length;
 		/* The length of this line. */
 #ifdef ENABLE_JUSTIFY
 	size_t quot_len = quote_length(line->data);
@@ -1248,7 +1316,7 @@ void do_wrap(void)
 		/* The length of the remainder. */
 
 	/* First find the last blank character where we can break the line. */
-	wrap_loc = break_line(line->data + lead_len, wrap_at - wideness(line->data, lead_len), FALSE);
+	wrap_loc = break_line(line->data + lead_len, wrap_at - wideness_in(line, lead_len), FALSE);
 
 	/* If no wrapping point was found before end-of-line, we don't wrap. */
 	if (wrap_loc < 0 || lead_len + wrap_loc == line_len)
@@ -1280,7 +1348,7 @@ void do_wrap(void)
 	 * line too long, then join the two lines, so that, after the line wrap,
 	 * the remainder will effectively have been prefixed to the next line. */
 	if (openfile->spillage_line && openfile->spillage_line == line->next &&
-				rest_length + breadth(line->next->data) <= wrap_at) {
+				rest_length + breadth_of(line->next) <= wrap_at) {
 		/* Go to the end of this line. */
 		openfile->current_x = line_len;
 
@@ -1289,9 +1357,10 @@ void do_wrap(void)
 #ifndef NANO_TINY
 			add_undo(ADD, NULL);
 #endif
-			line->data = nrealloc(line->data, line_len + 2);
+			line->data = realloc_text(line->data, line_len + 2);
 			line->data[line_len] = ' ';
 			line->data[line_len + 1] = '\0';
+			remeasure(line);
 			rest_length++;
 			openfile->totsize++;
 			openfile->current_x++;
@@ -1344,11 +1413,12 @@ void do_wrap(void)
 	/* If the original line has quoting, copy it to the spillage line. */
 	if (quot_len > 0) {
 		line = line->next;
-		line_len = strlen(line->data);
-		line->data = nrealloc(line->data, lead_len + line_len + 1);
+		line_len = line->length;
+		line->data = realloc_text(line->data, lead_len + line_len + 1);
 
 		memmove(line->data + lead_len, line->data, line_len + 1);
 		strncpy(line->data, line->prev->data, lead_len);
+		remeasure(line);
 
 		openfile->current_x += lead_len;
 		openfile->totsize += lead_len;
@@ -1511,8 +1581,8 @@ bool begpar(const linestruct *const line, int depth)
 		return TRUE;
 
 	/* If indentation of this and preceding line are equal, this is not a BOP. */
-	if (wideness(line->prev->data, quot_len + prev_dent_len) ==
-						wideness(line->data, quot_len + indent_len))
+	if (wideness_in(line->prev, quot_len + prev_dent_len) ==
+						wideness_in(line, quot_len + indent_len))
 		return FALSE;
 
 	/* Otherwise, this is a BOP if the preceding line is not. */
@@ -1550,7 +1620,7 @@ bool find_paragraph(linestruct **firstline, size_t *const linecount)
 		return FALSE;
 
 	/* We found a paragraph; determine its number of lines. */
-	*linecount = line->lineno - (*firstline)->lineno + 1;
+	*linecount = lineno_of(line) - lineno_of(*firstline) + 1;
 
 	return TRUE;
 }
@@ -1562,21 +1632,22 @@ void concat_paragraph(linestruct *line, size_t count)
 {
 	while (count > 1) {
 		linestruct *next_line = line->next;
-		size_t next_line_len = strlen(next_line->data);
+		size_t next_line_len = next_line->length;
 		size_t next_quot_len = quote_length(next_line->data);
 		size_t next_lead_len = next_quot_len + indent_length(next_line->data + next_quot_len);
-		size_t line_len = strlen(line->data);
+		size_t line_len = line->length;
 
 		/* We're just about to tack the next line onto this one.  If
 		 * this line isn't empty, make sure it ends in a space. */
 		if (line_len > 0 && line->data[line_len - 1] != ' ') {
-			line->data = nrealloc(line->data, line_len + 2);
+			line->data = realloc_text(line->data, line_len + 2);
 			line->data[line_len++] = ' ';
 			line->data[line_len] = '\0';
 		}
 
-		line->data = nrealloc(line->data, line_len + next_line_len - next_lead_len + 1);
-		strcat(line->data, next_line->data + next_lead_len);
+		line->data = realloc_text(line->data, line_len + next_line_len - next_lead_len + 1);
+		strcpy(line->data + line_len, next_line->data + next_lead_len);
+		remeasure(line);
 #ifndef NANO_TINY
 		line->has_anchor |= next_line->has_anchor;
 #endif
@@ -1644,6 +1715,7 @@ void squeeze(linestruct *line, size_t skip)
 		to--;
 
 	*to = '\0';
+	remeasure(line);
 }
 
 /* Rewrap the given line (that starts with the given lead string which is of
@@ -1653,12 +1725,12 @@ void rewrap_paragraph(linestruct **line, char *lead_string, size_t lead_len)
 	ssize_t break_pos;
 		/* The x-coordinate where the current line is to be broken. */
 
-	while (breadth((*line)->data) > wrap_at) {
-		size_t line_len = strlen((*line)->data);
+	while (breadth_of((*line)) > wrap_at) {
+		size_t line_len = (*line)->length;
 
 		/* Find a point in the line where it can be broken. */
 		break_pos = break_line((*line)->data + lead_len,
-						wrap_at - wideness((*line)->data, lead_len), FALSE);
+						wrap_at - wideness_in((*line), lead_len), FALSE);
 
 		/* If we can't break the line, or don't need to, we're done. */
 		if (break_pos < 0 || lead_len + break_pos == line_len)
@@ -1674,6 +1746,7 @@ void rewrap_paragraph(linestruct **line, char *lead_string, size_t lead_len)
 		(*line)->next->data = nmalloc(lead_len + line_len - break_pos + 1);
 		strncpy((*line)->next->data, lead_string, lead_len);
 		strcpy((*line)->next->data + lead_len, (*line)->data + break_pos);
+		remeasure((*line)->next);
 
 		/* When requested, snip the one or two trailing spaces. */
 		if (ISSET(TRIM_BLANKS)) {
@@ -1683,12 +1756,13 @@ void rewrap_paragraph(linestruct **line, char *lead_string, size_t lead_len)
 
 		/* Now actually break the current line, and go to the next. */
 		(*line)->data[break_pos] = '\0';
+		remeasure(*line);
 		*line = (*line)->next;
 	}
 
 #ifdef ENABLE_COLOR
 	/* If the new paragraph exceeds the viewport, recalculate the multidata. */
-	if ((*line)->lineno >= editwinrows)
+	if (lineno_of(*line) >= editwinrows)
 		recook = TRUE;
 #endif
 
@@ -1764,7 +1838,7 @@ void justify_text(bool whole_buffer)
 		/* The leading part for lines after the first one. */
 	size_t secondary_len = 0;
 		/* The length of that later lead. */
-	ssize_t was_the_linenumber = openfile->current->lineno;
+	ssize_t was_the_linenumber = lineno_of(openfile->current);
 		/* The line to return to after a full justification. */
 	bool marked_backward = (openfile->mark && !mark_is_before_cursor());
 
@@ -1845,7 +1919,7 @@ void justify_text(bool whole_buffer)
 		openfile->current = endline;
 		openfile->current_x = end_x;
 
-		linecount = endline->lineno - startline->lineno + (end_x > 0 ? 1 : 0);
+		linecount = lineno_of(endline) - lineno_of(startline) + (end_x > 0 ? 1 : 0);
 
 		/* Remember whether the end of the region was before the end-of-line. */
 		before_eol = (endline->data[end_x] != '\0');
@@ -1863,7 +1937,7 @@ void justify_text(bool whole_buffer)
 		 * search fails, there is nothing to justify, and we will be on the
 		 * last line of the file, so put the cursor at the end of it. */
 		if (!find_paragraph(&openfile->current, &linecount)) {
-			openfile->current_x = strlen(openfile->filebot->data);
+			openfile->current_x = openfile->filebot->length;
 #ifndef NANO_TINY
 			discard_until(openfile->undotop->next);
 #endif
@@ -1890,7 +1964,7 @@ void justify_text(bool whole_buffer)
 			endline = endline->next;
 			end_x = 0;
 		} else
-			end_x = strlen(endline->data);
+			end_x = endline->length;
 	}
 
 #ifndef NANO_TINY
@@ -1906,7 +1980,7 @@ void justify_text(bool whole_buffer)
 		linestruct *line = cutbuffer;
 		size_t quot_len = quote_length(line->data);
 		size_t fore_len = quot_len + indent_length(line->data + quot_len);
-		size_t text_len = strlen(line->data) - fore_len;
+		size_t text_len = line->length - fore_len;
 
 		/* If the extracted region begins with any leading part, trim it. */
 		if (fore_len > 0)
@@ -1914,11 +1988,13 @@ void justify_text(bool whole_buffer)
 
 		/* Then copy back in the leading part that it should have. */
 		if (primary_len > 0) {
-			line->data = nrealloc(line->data, primary_len + text_len + 1);
+			line->data = realloc_text(line->data, primary_len + text_len + 1);
 			memmove(line->data + primary_len, line->data, text_len + 1);
 			strncpy(line->data, primary_lead, primary_len);
 		}
 
+		remeasure(line);
+
 		/* Now justify the extracted region. */
 		concat_paragraph(cutbuffer, linecount);
 		squeeze(cutbuffer, primary_len);
@@ -1938,6 +2014,7 @@ void justify_text(bool whole_buffer)
 		if (end_x > 0 && before_eol) {
 			line->next = make_new_node(line);
 			line->next->data = copy_of(primary_lead);
+			remeasure(line->next);
 		}
 
 		free(secondary_lead);
@@ -2100,7 +2177,7 @@ bool replace_buffer(const char *filename, undo_type action, const char *operatio
 void treat(char *tempfile_name, char *theprogram, bool spelling)
 {
 #if defined(HAVE_FORK) && defined(HAVE_WAIT)
-	ssize_t was_lineno = openfile->current->lineno;
+	ssize_t was_lineno = lineno_of(openfile->current);
 	size_t was_pww = openfile->placewewant;
 	size_t was_x = openfile->current_x;
 	bool was_at_eol = (openfile->current->data[openfile->current_x] == '\0');
@@ -2189,7 +2266,7 @@ void treat(char *tempfile_name, char *theprogram, bool spelling)
 #ifndef NANO_TINY
 	/* Replace the marked text (or entire text) with the corrected text. */
 	if (spelling && openfile->mark) {
-		ssize_t was_mark_lineno = openfile->mark->lineno;
+		ssize_t was_mark_lineno = lineno_of(openfile->mark);
 		bool upright = mark_is_before_cursor();
 
 		replaced = replace_buffer(tempfile_name, CUT, "spelling correction");
@@ -2211,8 +2288,8 @@ void treat(char *tempfile_name, char *theprogram, bool spelling)
 
 	/* Go back to the old position. */
 	goto_line_posx(was_lineno, was_x);
-	if (was_at_eol || openfile->current_x > strlen(openfile->current->data))
-		openfile->current_x = strlen(openfile->current->data);
+	if (was_at_eol || openfile->current_x > openfile->current->length)
+		openfile->current_x = openfile->current->length;
 
 	if (replaced) {
 #ifndef NANO_TINY
@@ -2546,6 +2623,10 @@ void do_spell(void)
 	if (in_restricted_mode())
 		return;
 
+#ifndef NANO_TINY
+	finish_loading();
+#endif
+
 	temp_name = safe_tempfile(&stream);
 
 	if (temp_name == NULL) {
@@ -2874,7 +2955,7 @@ void do_linter(void)
 			/* Put the cursor at the reported position, but don't go beyond EOL
 			 * when the second number is a column number instead of an index. */
 			goto_line_posx(curlint->lineno, curlint->colno - 1);
-			openfile->current_x = actual_x(openfile->current->data, openfile->placewewant);
+			openfile->current_x = actual_x_in(openfile->current, openfile->placewewant);
 			titlebar(NULL);
 			adjust_viewport(CENTERING);
 #ifdef ENABLE_LINENUMBERS
@@ -2970,6 +3051,8 @@ void do_formatter(void)
 
 #ifndef NANO_TINY
 	openfile->mark = NULL;
+
+	finish_loading();
 #endif
 
 	temp_name = safe_tempfile(&stream);
@@ -3013,13 +3096,13 @@ void count_lines_words_and_characters(void)
 		topline = openfile->filetop;
 		top_x = 0;
 		botline = openfile->filebot;
-		bot_x = strlen(botline->data);
+		bot_x = botline->length;
 
 		chars = openfile->totsize;
 	}
 
 	/* Compute the number of lines. */
-	lines = botline->lineno - topline->lineno;
+	lines = lineno_of(botline) - lineno_of(topline);
 	lines += (bot_x == 0 || (topline == botline && top_x == bot_x)) ? 0 : 1;
 
 	openfile->current = topline;
@@ -3028,7 +3111,7 @@ void count_lines_words_and_characters(void)
 	/* Keep stepping to the next word (considering punctuation as part of a
 	 * word, as "wc -w" does), until we reach the end of the relevant area,
 	 * incrementing the word count for each successful step. */
-	while (openfile->current->lineno < botline->lineno ||
+	while (lineno_of(openfile->current) < lineno_of(botline) ||
 				(openfile->current == botline && openfile->current_x < bot_x)) {
 		if (do_next_word(FALSE))
 			words++;
@@ -3185,7 +3268,7 @@ void complete_a_word(void)
 
 	/* Run through all of the lines in the buffer, looking for shard. */
 	while (pletion_line) {
-		ssize_t threshold = strlen(pletion_line->data) - shard_length;
+		ssize_t threshold = pletion_line->length - shard_length;
 				/* The point where we can stop searching for shard. */
 		completionstruct *some_word;
 		char *completion;
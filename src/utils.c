@@ -27,6 +27,8 @@
 #endif
 #include <string.h>
 #include <unistd.h>
+#define WIN32_LEAN_AND_MEAN 1
+#include <windows.h>
 #include <shlobj.h>
 
 /* Set global variable `homedir` to the user's home directory.  First try
@@ -207,57 +209,113 @@ bool is_separate_word(size_t position, size_t length, const char *text)
 }
 #endif /* ENABLE_SPELLER */
 
-/* Return the position of the needle in the haystack, or NULL if not found.
- * When searching backwards, we will find the last match that starts no later
- * than the given start; otherwise, we find the first match starting no earlier
- * than start.  If we are doing a regexp search, and we find a match, we fill
- * in the global variable regmatches with at most 9 subexpression matches. */
-const char *strstrwrapper(const char *haystack, const char *needle, const char *start)
+/* The text of the line that was last swept for regex matches, its length,
+ * and the regex (and its case sensitivity) that was used for this. */
+static char *swept_text = NULL;
+static size_t swept_length = 0;
+static char *swept_regex = NULL;
+static bool swept_sensitively;
+/* For each match in that line, where it starts, and from where it was found. */
+static size_t *match_starts = NULL, *match_rungs = NULL;
+static size_t match_count = 0;
+
+/* Find, in a single forward sweep, the start of every match of the search
+ * regex in the given haystack, stepping one character past the start of
+ * each match, and remember them for the line when there are any. */
+void sweep_for_matches(const char *haystack, size_t length, const char *regex)
 {
-	if (ISSET(USE_REGEXP)) {
-		if (ISSET(BACKWARDS_SEARCH)) {
-			size_t last_find, ceiling, far_end;
-			size_t floor = 0, next_rung = 0;
-				/* The start of the search range, and the next start. */
-
-			if (regexec(&search_regexp, haystack, 1, regmatches, 0) != 0)
-				return NULL;
-
-			far_end = strlen(haystack);
-			ceiling = start - haystack;
-			last_find = regmatches[0].rm_so;
-
-			/* A result beyond the search range also means: no match. */
-			if (last_find > ceiling)
-				return NULL;
-
-			/* Move the start-of-range forward until there is no more match;
-			 * then the last match found is the first match backwards. */
-			while (regmatches[0].rm_so <= ceiling) {
-				floor = next_rung;
-				last_find = regmatches[0].rm_so;
-				/* If this is the last possible match, don't try to advance. */
-				if (last_find == ceiling)
-					break;
-				next_rung = step_right(haystack, last_find);
-				regmatches[0].rm_so = next_rung;
-				regmatches[0].rm_eo = far_end;
-				if (regexec(&search_regexp, haystack, 1, regmatches, REG_STARTEND) != 0)
-					break;
-			}
-
-			/* Find the last match again, to get possible submatches. */
-			regmatches[0].rm_so = floor;
-			regmatches[0].rm_eo = far_end;
-			if (regexec(&search_regexp, haystack, 10, regmatches, REG_STARTEND) != 0)
-				return NULL;
+	size_t rung = 0, allotted = 0;
 
-			return haystack + regmatches[0].rm_so;
+	free(swept_text);
+	swept_text = NULL;
+	match_count = 0;
+
+	while (TRUE) {
+		regmatches[0].rm_so = rung;
+		regmatches[0].rm_eo = length;
+		if (regexec(&search_regexp, haystack, 1, regmatches, REG_STARTEND) != 0)
+			break;
+
+		if (match_count == allotted) {
+			allotted = (allotted == 0) ? 64 : 2 * allotted;
+			match_starts = nrealloc(match_starts, allotted * sizeof(size_t));
+			match_rungs = nrealloc(match_rungs, allotted * sizeof(size_t));
 		}
 
+		match_starts[match_count] = regmatches[0].rm_so;
+		match_rungs[match_count++] = rung;
+
+		/* A match at the very end of the line is the last possible one. */
+		if (regmatches[0].rm_so >= length)
+			break;
+
+		rung = step_right(haystack, regmatches[0].rm_so);
+	}
+
+	if (match_count > 0) {
+		swept_text = measured_copy(haystack, length);
+		swept_length = length;
+		free(swept_regex);
+		swept_regex = copy_of(regex);
+		swept_sensitively = ISSET(CASE_SENSITIVE);
+	}
+}
+
+/* Return the start of the last match of the search regex in the given
+ * haystack that starts no later than ceiling, or NULL when there is none.
+ * The matches in a line are found once, and are reused for as long as
+ * the same line is searched with the same regex. */
+const char *last_regex_match(const char *haystack, size_t length,
+										const char *regex, size_t ceiling)
+{
+	size_t low = 0, high;
+
+	if (swept_text == NULL || length != swept_length || strcmp(regex, swept_regex) != 0 ||
+				swept_sensitively != ISSET(CASE_SENSITIVE) ||
+				memcmp(haystack, swept_text, length) != 0)
+		sweep_for_matches(haystack, length, regex);
+
+	high = match_count;
+
+	/* Look for the first match that starts beyond the ceiling. */
+	while (low < high) {
+		size_t middle = (low + high) / 2;
+
+		if (match_starts[middle] <= ceiling)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	if (low == 0)
+		return NULL;
+
+	/* Find the match before it again, to get possible submatches. */
+	regmatches[0].rm_so = match_rungs[low - 1];
+	regmatches[0].rm_eo = length;
+	if (regexec(&search_regexp, haystack, 10, regmatches, REG_STARTEND) != 0)
+		return NULL;
+
+	return haystack + regmatches[0].rm_so;
+}
+
+/* Return the position of the needle in the haystack (of the given length),
+ * or NULL if not found.  When searching backwards, we will find the last match
+ * that starts no later than the given start; otherwise, we find the first match
+ * starting no earlier than start.  If we are doing a regexp search, and we find
+ * a match, we fill in the global variable regmatches with at most 9 subexpression
+ * matches.  A literal search requires that the needle was passed beforehand
+ * to prepare_for_literal_search() or prepare_for_caseless_search(). */
+const char *strstrwrapper(const char *haystack, size_t length, const char *needle,
+							const char *start)
+{
+	if (ISSET(USE_REGEXP)) {
+		if (ISSET(BACKWARDS_SEARCH))
+			return last_regex_match(haystack, length, needle, start - haystack);
+
 		/* Do a forward regex search from the starting point. */
 		regmatches[0].rm_so = start - haystack;
-		regmatches[0].rm_eo = strlen(haystack);
+		regmatches[0].rm_eo = length;
 		if (regexec(&search_regexp, haystack, 10, regmatches, REG_STARTEND) != 0)
 			return NULL;
 		else
@@ -266,15 +324,15 @@ const char *strstrwrapper(const char *haystack, const char *needle, const char *
 
 	if (ISSET(CASE_SENSITIVE)) {
 		if (ISSET(BACKWARDS_SEARCH))
-			return revstrstr(haystack, needle, start);
+			return rfind_literal(haystack, length, start);
 		else
-			return strstr(start, needle);
+			return find_literal(haystack, length, start);
 	}
 
 	if (ISSET(BACKWARDS_SEARCH))
-		return mbrevstrcasestr(haystack, needle, start);
+		return rfind_caseless(haystack, length, start);
 	else
-		return mbstrcasestr(start, needle);
+		return find_caseless(haystack, length, start);
 }
 
 /* Allocate the given amount of memory and return a pointer to it. */
@@ -329,6 +387,172 @@ char *copy_of(const char *string)
 	return measured_copy(string, strlen(string));
 }
 
+#ifndef NANO_TINY
+/* Return the slot in the grain map where the given grain sits, or the free
+ * slot where it would go. */
+size_t grain_slot(uintptr_t grain)
+{
+	size_t slot = (grain * 2654435761u) & (grainslots - 1);
+
+	while (grainmap[slot].block && grainmap[slot].grain != grain)
+		slot = (slot + 1) & (grainslots - 1);
+
+	return slot;
+}
+
+/* Note in the grain map that the given grain belongs to the given block. */
+void map_grain(uintptr_t grain, blockstruct *block)
+{
+	size_t slot;
+
+	/* Keep the table at most half full, so that the probe chains stay short. */
+	if (2 * (grainsused + 1) > grainslots) {
+		grainstruct *oldmap = grainmap;
+		size_t oldslots = grainslots;
+
+		grainslots = (oldslots ? 2 * oldslots : 1024);
+		grainmap = nmalloc(grainslots * sizeof(grainstruct));
+
+		for (slot = 0; slot < grainslots; slot++)
+			grainmap[slot].block = NULL;
+
+		for (slot = 0; slot < oldslots; slot++)
+			if (oldmap[slot].block)
+				grainmap[grain_slot(oldmap[slot].grain)] = oldmap[slot];
+
+		free(oldmap);
+	}
+
+	slot = grain_slot(grain);
+	grainmap[slot].grain = grain;
+	grainmap[slot].block = block;
+	grainsused++;
+}
+
+/* Remove the given grain from the grain map, moving back any later entries
+ * of the same probe chain, so that they can still be found. */
+void unmap_grain(uintptr_t grain)
+{
+	size_t hole = grain_slot(grain);
+	size_t slot = hole;
+
+	grainmap[hole].block = NULL;
+	grainsused--;
+
+	while (TRUE) {
+		size_t home;
+
+		slot = (slot + 1) & (grainslots - 1);
+
+		if (grainmap[slot].block == NULL)
+			return;
+
+		home = (grainmap[slot].grain * 2654435761u) & (grainslots - 1);
+
+		/* An entry can fill the hole when its home lies cyclically outside
+		 * the stretch between the hole and its current slot. */
+		if ((slot > hole) ? (home <= hole || home > slot) : (home <= hole && home > slot)) {
+			grainmap[hole] = grainmap[slot];
+			grainmap[slot].block = NULL;
+			hole = slot;
+		}
+	}
+}
+
+/* Allocate a block of memory of the given size into which a file can be read
+ * in whole, and note in the grain map which grains it occupies.  Return NULL
+ * when the memory cannot be had, so that the caller can read piecemeal. */
+blockstruct *new_text_block(size_t size)
+{
+	size_t grains = (size + GRAIN_SIZE - 1) / GRAIN_SIZE;
+	blockstruct *block = malloc(sizeof(blockstruct));
+
+	if (block == NULL || size == 0) {
+		free(block);
+		return NULL;
+	}
+
+	/* Taking whole grains means that no other memory shares them, so that
+	 * the grain of a text tells whether the text lies in a block. */
+	block->start = VirtualAlloc(NULL, grains * GRAIN_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+	if (block->start == NULL) {
+		free(block);
+		return NULL;
+	}
+
+	block->size = size;
+	block->users = 0;
+
+	for (size_t index = 0; index < grains; index++)
+		map_grain((uintptr_t)block->start / GRAIN_SIZE + index, block);
+
+	return block;
+}
+
+/* Return the block in which the given text lies, or NULL when there is none. */
+blockstruct *block_holding(const char *text)
+{
+	if (grainsused == 0)
+		return NULL;
+
+	return grainmap[grain_slot((uintptr_t)text / GRAIN_SIZE)].block;
+}
+
+/* Note that one line less uses the given block, and free the block when it
+ * is no longer used by any line. */
+void release_text_block(blockstruct *block)
+{
+	size_t grains = (block->size + GRAIN_SIZE - 1) / GRAIN_SIZE;
+
+	if (block->users > 0 && --block->users > 0)
+		return;
+
+	for (size_t index = 0; index < grains; index++)
+		unmap_grain((uintptr_t)block->start / GRAIN_SIZE + index);
+
+	VirtualFree(block->start, 0, MEM_RELEASE);
+	free(block);
+}
+#endif
+
+/* Free the given text of a line, which may lie inside a block or a node. */
+void free_text(char *text)
+{
+#ifndef NANO_TINY
+	blockstruct *block = block_holding(text);
+
+	/* A text inside a line node goes away with the node. */
+	if (block) {
+		if (block != &slabmark)
+			release_text_block(block);
+		return;
+	}
+#endif
+	free(text);
+}
+
+/* Reallocate the given text of a line to have the given size.  When the text
+ * lies inside a block or inside the node, first give the line its own copy. */
+char *realloc_text(char *text, size_t howmuch)
+{
+#ifndef NANO_TINY
+	blockstruct *block = block_holding(text);
+
+	if (block) {
+		size_t length = strlen(text) + 1;
+		char *copy = nmalloc(howmuch);
+
+		memcpy(copy, text, (length < howmuch) ? length : howmuch);
+		if (block != &slabmark)
+			release_text_block(block);
+
+		return copy;
+	}
+#endif
+	return nrealloc(text, howmuch);
+}
+
 /* Free the string at dest and return the string at src. */
 char *free_and_assign(char *dest, char *src)
 {
@@ -418,10 +642,36 @@ size_t breadth(const char *text)
 	return span;
 }
 
+/* Return the number of columns that the first count bytes of the given line
+ * occupy.  For a line of only printable ASCII, this is simply count. */
+size_t wideness_in(const linestruct *line, size_t count)
+{
+	if (line->plain)
+		return (count < line->length) ? count : line->length;
+
+	return wideness(line->data, count);
+}
+
+/* Return the index in the given line of the character that covers the given
+ * column.  For a line of only printable ASCII, this is simply the column. */
+size_t actual_x_in(const linestruct *line, size_t column)
+{
+	if (line->plain)
+		return (column < line->length) ? column : line->length;
+
+	return actual_x(line->data, column);
+}
+
+/* Return the number of columns that the given line occupies. */
+size_t breadth_of(const linestruct *line)
+{
+	return (line->plain) ? line->length : breadth(line->data);
+}
+
 /* Return the (zero-based) column position of the cursor. */
 size_t xplustabs(void)
 {
-	return wideness(openfile->current->data, openfile->current_x);
+	return wideness_in(openfile->current, openfile->current_x);
 }
 
 /* Append a new magic line to the end of the buffer. */
@@ -431,6 +681,9 @@ void new_magicline(void)
 	openfile->filebot->next->data = copy_of("");
 	openfile->filebot = openfile->filebot->next;
 	openfile->totsize++;
+#ifndef NANO_TINY
+	openfile->filebot->stamp = openfile->generation;
+#endif
 }
 
 #if !defined(NANO_TINY) || defined(ENABLE_HELP)
@@ -453,7 +706,7 @@ void remove_magicline(void)
 /* Return TRUE when the mark is before or at the cursor, and FALSE otherwise. */
 bool mark_is_before_cursor(void)
 {
-	return (openfile->mark->lineno < openfile->current->lineno ||
+	return (lineno_of(openfile->mark) < lineno_of(openfile->current) ||
 						(openfile->mark == openfile->current &&
 						openfile->mark_x <= openfile->current_x));
 }
@@ -501,13 +754,35 @@ void get_range(linestruct **top, linestruct **bot)
 linestruct *line_from_number(ssize_t number)
 {
 	linestruct *line = openfile->current;
+	ssize_t distance = number - lineno_of(line);
+#ifndef NANO_TINY
+	size_t lower = 0, upper;
 
-	if (line->lineno > number)
-		while (line->lineno != number)
-			line = line->prev;
-	else
-		while (line->lineno != number)
-			line = line->next;
+	if (openfile->signposts == NULL)
+		index_the_lines();
+
+	upper = openfile->signcount;
+
+	/* Find the last line in the index that does not lie beyond the wanted one. */
+	while (upper - lower > 1) {
+		size_t middle = (lower + upper) / 2;
+
+		if (lineno_of(openfile->signposts[middle]) > number)
+			upper = middle;
+		else
+			lower = middle;
+	}
+
+	/* Start from that line, unless the current line is nearer. */
+	if (number - lineno_of(openfile->signposts[lower]) < (distance < 0 ? -distance : distance)) {
+		line = openfile->signposts[lower];
+		distance = number - lineno_of(line);
+	}
+#endif
+	for (; distance < 0; distance++)
+		line = line->prev;
+	for (; distance > 0; distance--)
+		line = line->next;
 
 	return line;
 }
@@ -521,7 +796,7 @@ size_t number_of_characters_in(const linestruct *begin, const linestruct *end)
 
 	/* Sum the number of characters (plus a newline) in each line. */
 	for (line = begin; line != end->next; line = line->next)
-		count += mbstrlen(line->data) + 1;
+		count += line->chars + 1;
 
 	/* Do not count the final newline. */
 	return (count - 1);
@@ -200,6 +200,8 @@ void read_keys_from(WINDOW *frame)
 	size_t errcount = 0;
 #ifndef NANO_TINY
 	bool timed = FALSE;
+	int patience = -1;
+		/* How long to wait for a keystroke before doing background work. */
 #endif
 
 	/* Before reading the first keycode, display any pending screen updates. */
@@ -225,6 +227,21 @@ void read_keys_from(WINDOW *frame)
 #ifdef NANO_TINY
 		input = wgetch(frame);
 #else
+		/* When there is work to do in the background, wait only so long. */
+		if (!timed && currmenu == MMAIN && frame == midwin) {
+			patience = background_pause();
+			wtimeout(frame, patience);
+		} else if (frame == footwin) {
+			/* While an incremental search is unfinished, don't wait at all. */
+			patience = (still_searching() ? 0 : -1);
+			wtimeout(frame, patience);
+		} else {
+			/* Elsewhere (in the help viewer or the file browser, or during a
+			 * half delay) just wait, whatever timeout an earlier read set. */
+			patience = -1;
+			wtimeout(frame, patience);
+		}
+
 		if (!the_window_resized)
 			input = wgetch(frame);
 		if (the_window_resized) {
@@ -255,6 +272,16 @@ void read_keys_from(WINDOW *frame)
 				continue;
 			}
 		}
+
+		if (input == ERR && patience >= 0 && frame == footwin) {
+			search_as_typed();
+			draw_the_promptbar();
+			doupdate();
+			continue;
+		} else if (input == ERR && patience >= 0) {
+			do_background_work();
+			continue;
+		}
 #endif
 		/* When we've failed to get a keycode millions of times in a row,
 		 * assume our input source is gone and die gracefully.  We could
@@ -264,6 +291,12 @@ void read_keys_from(WINDOW *frame)
 			die(_("Too many errors from stdin\n"));
 	}
 
+#ifndef NANO_TINY
+	/* A ^C that came while waiting stops a reading; a further ^C is
+	 * a normal keystroke again. */
+	listen_for_Ctrl_C(FALSE);
+#endif
+
 	curs_set(0);
 
 	/* When there is no keystroke buffer yet, allocate one. */
@@ -1610,7 +1643,7 @@ int get_mouseinput(int *mouse_y, int *mouse_x)
 		if (in_middle && sidebar && event.x == (COLS - 1) && currmenu == MMAIN) {
 			wmouse_trafo(midwin, mouse_y, mouse_x, FALSE);
 			*mouse_y += (*mouse_y ? 1 : 0);
-			goto_line_and_column(openfile->filebot->lineno * *mouse_y / editwinrows + 1,
+			goto_line_and_column(lineno_of(openfile->filebot) * *mouse_y / editwinrows + 1,
 									openfile->placewewant + 1, TRUE);
 			refresh_needed = TRUE;
 		} else
@@ -1965,6 +1998,27 @@ char *display_string(const char *text, size_t column, size_t span,
 	return converted;
 }
 
+/* Convert the part of the given line that starts at the given column and
+ * spans the given number of columns into its displayable form. */
+char *display_line(const linestruct *line, size_t column, size_t span)
+{
+	size_t start_x;
+	char *converted;
+
+	if (!line->plain)
+		return display_string(line->data, column, span, TRUE, FALSE);
+
+	/* In a line of only printable ASCII, a column is also a byte index,
+	 * so there is no need to decode the part before the given column. */
+	start_x = (column < line->length) ? column : line->length;
+	converted = display_string(line->data + start_x, 0, span, TRUE, FALSE);
+
+	from_x += start_x;
+	till_x += start_x;
+
+	return converted;
+}
+
 #ifdef ENABLE_MULTIBUFFER
 /* Determine the sequence number of the given buffer in the circular list. */
 int buffer_number(openfilestruct *buffer)
@@ -2016,6 +2070,10 @@ void titlebar(const char *path)
 		/* The presentable form of the pathname. */
 	char *ranking = NULL;
 		/* The buffer sequence number plus the total buffer count. */
+#ifndef NANO_TINY
+	char gauge[60];
+		/* How far the loading of the file has come. */
+#endif
 
 	/* If the screen is too small, there is no title bar. */
 	if (topwin == NULL)
@@ -2059,6 +2117,12 @@ void titlebar(const char *path)
 		else
 			path = openfile->filename;
 
+#ifndef NANO_TINY
+		if (openfile->loading) {
+			snprintf(gauge, sizeof(gauge), "%s %i%%", _("Loading"), loaded_percentage());
+			state = gauge;
+		} else
+#endif
 		if (ISSET(VIEW_MODE))
 			state = _("View");
 #ifndef NANO_TINY
@@ -2128,7 +2192,7 @@ void titlebar(const char *path)
 #ifndef NANO_TINY
 	/* When requested, show on the title bar the state of three options and
 	 * the state of the mark and whether a macro is being recorded. */
-	if (*state && ISSET(STATEFLAGS) && !ISSET(VIEW_MODE)) {
+	if (*state && ISSET(STATEFLAGS) && !ISSET(VIEW_MODE) && !openfile->loading) {
 		if (openfile->modified && COLS > 1)
 			waddstr(topwin, " *");
 		if (statelen < COLS) {
@@ -2175,7 +2239,7 @@ void minibar(void)
 	} else
 		thename = copy_of(_("(nameless)"));
 
-	sprintf(location, "%zi,%zi", openfile->current->lineno, xplustabs() + 1);
+	sprintf(location, "%zi,%zi", lineno_of(openfile->current), xplustabs() + 1);
 	placewidth = strlen(location);
 	namewidth = breadth(thename);
 
@@ -2198,10 +2262,22 @@ void minibar(void)
 		waddstr(footwin, openfile->modified ? " *" : "  ");
 	}
 
-	/* Right after reading or writing a file, display its number of lines;
-	 * otherwise, when there are multiple buffers, display an [x/n] counter. */
+	/* While the file is being loaded, display how far this has come; right
+	 * after reading or writing a file, display its number of lines; otherwise,
+	 * when there are multiple buffers, display an [x/n] counter. */
+#ifndef NANO_TINY
+	if (openfile->loading && COLS > 35) {
+		number_of_lines = nmalloc(60);
+		snprintf(number_of_lines, 60, " (%s %i%%)", _("Loading"), loaded_percentage());
+		tallywidth = breadth(number_of_lines);
+		if (namewidth + tallywidth + 11 < COLS)
+			waddstr(footwin, number_of_lines);
+		else
+			tallywidth = 0;
+	} else
+#endif
 	if (report_size && COLS > 35) {
-		size_t count = openfile->filebot->lineno - (openfile->filebot->data[0] == '\0');
+		size_t count = lineno_of(openfile->filebot) - (openfile->filebot->data[0] == '\0');
 
 		number_of_lines = nmalloc(49);
 		if (openfile->fmt == NIX_FILE || openfile->fmt == UNSPECIFIED)
@@ -2281,7 +2357,7 @@ void minibar(void)
 
 	/* Display how many percent the current line is into the file. */
 	if (namewidth + 6 < COLS) {
-		sprintf(location, "%3zi%%", 100 * openfile->current->lineno / openfile->filebot->lineno);
+		sprintf(location, "%3zi%%", 100 * lineno_of(openfile->current) / lineno_of(openfile->filebot));
 		mvwaddstr(footwin, 0, COLS - 4 - padding, location);
 	}
 
@@ -2524,7 +2600,7 @@ void place_the_cursor(void)
 	} else
 #endif
 	{
-		row = openfile->current->lineno - openfile->edittop->lineno;
+		row = lineno_of(openfile->current) - lineno_of(openfile->edittop);
 		column -= get_page_start(column);
 	}
 
@@ -2545,6 +2621,224 @@ void place_the_cursor(void)
 /* The number of bytes after which to stop painting, to avoid major slowdowns. */
 #define PAINT_LIMIT  2000
 
+#ifdef ENABLE_COLOR
+/* Determine which pieces of the given line get colored by which rule of the
+ * current syntax, looking for single-line matches only up to the given index.
+ * Update the multidata of the line along the way, and return the coloring. */
+const painttype *color_the_line(linestruct *line, size_t reach)
+{
+	painttype *paint = fresh_paint_for(line, reach);
+	const colortype *varnish = openfile->syntax->color;
+	bool sifted = (openfile->syntax->sieve->count > 0 && line->length < PAINT_LIMIT);
+		/* Whether the line gets looked through for the literals of rules. */
+
+	/* If there are multiline regexes, make sure this line has a cache. */
+	if (openfile->syntax->multiscore > 0 && !HAS_MULTIDATA(line))
+		provide_multidata(line);
+
+	/* Find out which single-line regexes could match on this line at all.
+	 * (For a very long line, the regexes themselves are quicker at this.) */
+	if (sifted)
+		sift_the_line(openfile->syntax->sieve, line->data,
+								openfile->syntax->sieve->found);
+
+	/* Iterate through all the coloring regexes. */
+	for (; varnish != NULL; varnish = varnish->next) {
+		size_t index = 0;
+			/* Where in the line we currently begin looking for a match. */
+		regmatch_t match;
+			/* The match positions of a single-line regex. */
+		const linestruct *priorline = line->prev;
+			/* The line before the current one, if any. */
+		regmatch_t startmatch, endmatch;
+			/* The match positions of the start and end regexes. */
+		short former;
+			/* The multiline-regex info that the line had before. */
+
+		/* First case: varnish is a single-line expression. */
+		if (varnish->end == NULL) {
+			/* When the line lacks all literals that a match needs, skip. */
+			if (sifted && varnish->clue >= 0 && !openfile->syntax->sieve->found[varnish->clue])
+				continue;
+
+			while (index < PAINT_LIMIT && index < reach) {
+				/* If there is no match, go on to the next line. */
+				if (regexec(varnish->start, &line->data[index], 1,
+							&match, (index == 0) ? 0 : REG_NOTBOL) != 0)
+					break;
+
+				/* Translate the match to the beginning of the line. */
+				match.rm_so += index;
+				match.rm_eo += index;
+				index = match.rm_eo;
+
+				/* If the match lies beyond the given index, this rule is done. */
+				if (match.rm_so >= reach)
+					break;
+
+				/* If the match has length zero, advance over it. */
+				if (match.rm_so == match.rm_eo) {
+					if (line->data[index] == '\0')
+						break;
+					index = step_right(line->data, index);
+					continue;
+				}
+
+				add_span(paint, match.rm_so, match.rm_eo, varnish->attributes);
+			}
+
+			continue;
+		}
+
+		/* Second case: varnish is a multiline expression. */
+
+		former = MULTIDATA(line)[varnish->id];
+
+		/* Assume nothing gets painted until proven otherwise below. */
+		MULTIDATA(line)[varnish->id] = NOTHING;
+
+		if (priorline && !HAS_MULTIDATA(priorline)) {
+			statusline(ALERT, "Missing multidata -- please report a bug");
+			/* Make sure that this coloring does not get used again. */
+			paint->syntax = NULL;
+		} else
+
+		/* If there is an unterminated start match before the current line,
+		 * we need to look for an end match first. */
+		if (priorline && (MULTIDATA(priorline)[varnish->id] == WHOLELINE ||
+							MULTIDATA(priorline)[varnish->id] == STARTSHERE)) {
+			/* If there is no end on this line, color whole line, and be done. */
+			if (regexec(varnish->end, line->data, 1, &endmatch, 0) == REG_NOMATCH) {
+				add_span(paint, 0, TO_THE_END, varnish->attributes);
+				MULTIDATA(line)[varnish->id] = WHOLELINE;
+
+				/* When the info changed, the lines after may be affected. */
+				if (former != WHOLELINE)
+					mark_as_stale(line);
+				continue;
+			}
+
+			/* Color the part up to the end match, if there is any. */
+			if (endmatch.rm_eo > 0)
+				add_span(paint, 0, endmatch.rm_eo, varnish->attributes);
+
+			MULTIDATA(line)[varnish->id] = ENDSHERE;
+			index = endmatch.rm_eo;
+		}
+
+		/* Now look for start matches on this line. */
+		while (index < PAINT_LIMIT && regexec(varnish->start, line->data + index,
+							1, &startmatch, (index == 0) ? 0 : REG_NOTBOL) == 0) {
+			/* Make the match relative to the beginning of the line. */
+			startmatch.rm_so += index;
+			startmatch.rm_eo += index;
+
+			if (regexec(varnish->end, line->data + startmatch.rm_eo, 1, &endmatch,
+								(startmatch.rm_eo == 0) ? 0 : REG_NOTBOL) == 0) {
+				/* Make the match relative to the beginning of the line. */
+				endmatch.rm_so += startmatch.rm_eo;
+				endmatch.rm_eo += startmatch.rm_eo;
+				/* Only color the match if it is more than zero characters long. */
+				if (endmatch.rm_eo > startmatch.rm_so) {
+					add_span(paint, startmatch.rm_so, endmatch.rm_eo, varnish->attributes);
+					MULTIDATA(line)[varnish->id] = JUSTONTHIS;
+				}
+				index = endmatch.rm_eo;
+				/* If both start and end match are anchors, advance. */
+				if (startmatch.rm_so == startmatch.rm_eo &&
+									endmatch.rm_so == endmatch.rm_eo) {
+					if (line->data[index] == '\0')
+						break;
+					index = step_right(line->data, index);
+				}
+				continue;
+			}
+
+			/* Color the rest of the line, and we're done. */
+			add_span(paint, startmatch.rm_so, TO_THE_END, varnish->attributes);
+			MULTIDATA(line)[varnish->id] = STARTSHERE;
+			break;
+		}
+
+		/* When the info changed, the lines after may be affected. */
+		if (former != MULTIDATA(line)[varnish->id])
+			mark_as_stale(line);
+	}
+
+	return paint;
+}
+
+#ifndef NANO_TINY
+/* The number of bytes of lines to color in one go while the user is idle. */
+#define COLORING_SLICE  4000
+
+/* The number of the line that was at the top of the viewport last time. */
+static ssize_t former_top = 0;
+/* Whether the viewport last moved toward the start of the buffer. */
+static bool heading_up = FALSE;
+
+/* Return the nearest line beyond the viewport, in the direction in which the
+ * viewport last moved, that does not have its coloring yet -- looking ahead
+ * for at most one screenful.  Return NULL when there is no such line. */
+linestruct *next_line_to_color(void)
+{
+	linestruct *line = openfile->edittop;
+	ssize_t top = lineno_of(line);
+	int ahead = 2 * editwinrows;
+
+	if (!openfile->syntax || ISSET(NO_SYNTAX))
+		return NULL;
+
+	if (top != former_top) {
+		heading_up = (top < former_top);
+		former_top = top;
+	}
+
+	/* When heading down, the lines in the viewport are looked at too, but
+	 * they were just drawn, so only the ones below them can lack coloring. */
+	if (heading_up) {
+		line = line->prev;
+		ahead = editwinrows;
+	}
+
+	for (; line != NULL && ahead > 0; ahead--) {
+		/* Without the multidata of the preceding line, nothing can be done. */
+		if (openfile->syntax->multiscore > 0 && line->prev && !HAS_MULTIDATA(line->prev))
+			return NULL;
+
+		if (!is_painted(line))
+			return line;
+
+		line = (heading_up) ? line->prev : line->next;
+	}
+
+	return NULL;
+}
+
+/* Return TRUE when some lines near the viewport still need to be colored. */
+bool coloring_ahead(void)
+{
+	return (next_line_to_color() != NULL);
+}
+
+/* Color a slice of the lines just beyond the viewport, so that they can be
+ * painted at once when the user scrolls them into view. */
+void color_some_lines_ahead(void)
+{
+	size_t budget = COLORING_SLICE;
+	linestruct *line;
+
+	while (budget > 0 && (line = next_line_to_color()) != NULL) {
+		/* Cover the whole line, as it is not known what part will be shown. */
+		color_the_line(line, line->length);
+
+		budget -= (line->length < budget) ? line->length : budget;
+		budget -= (budget > 40) ? 40 : budget;
+	}
+}
+#endif /* !NANO_TINY */
+#endif /* ENABLE_COLOR */
+
 /* Draw the given text on the given row of the edit window.  line is the
  * line to be drawn, and converted is the actual string to be written with
  * tabs and control characters replaced by strings of regular characters.
@@ -2561,7 +2855,7 @@ void draw_row(int row, const char *converted, linestruct *line, size_t from_col)
 			mvwprintw(midwin, row, 0, "%*s", margin - 1, " ");
 		else
 #endif
-			mvwprintw(midwin, row, 0, "%*zd", margin - 1, line->lineno);
+			mvwprintw(midwin, row, 0, "%*zd", margin - 1, lineno_of(line));
 		wattroff(midwin, interface_color_pair[LINE_NUMBER]);
 #ifndef NANO_TINY
 		if (line->has_anchor && (from_col == 0 || !ISSET(SOFTWRAP)))
@@ -2588,157 +2882,37 @@ void draw_row(int row, const char *converted, linestruct *line, size_t from_col)
 #ifdef ENABLE_COLOR
 	/* If there are color rules (and coloring is turned on), apply them. */
 	if (openfile->syntax && !ISSET(NO_SYNTAX)) {
-		const colortype *varnish = openfile->syntax->color;
+		const painttype *paint = paint_of(line, till_x);
 
-		/* If there are multiline regexes, make sure this line has a cache. */
-		if (openfile->syntax->multiscore > 0 && line->multidata == NULL)
-			line->multidata = nmalloc(openfile->syntax->multiscore * sizeof(short));
+		/* When the coloring of the line is not known (anymore), determine it. */
+		if (paint == NULL)
+			paint = color_the_line(line, till_x);
 
-		/* Iterate through all the coloring regexes. */
-		for (; varnish != NULL; varnish = varnish->next) {
-			size_t index = 0;
-				/* Where in the line we currently begin looking for a match. */
+		/* Paint the colored pieces that are onscreen, in the order of the rules. */
+		for (size_t index = 0; index < paint->count; index++) {
+			const spantype *span = &paint->spans[index];
 			int start_col = 0;
 				/* The starting column of a piece to paint.  Zero-based. */
-			int paintlen = 0;
-				/* The number of characters to paint. */
+			int paintlen = -1;
+				/* The number of characters to paint.  Negative means "all". */
 			const char *thetext;
 				/* The place in converted from where painting starts. */
-			regmatch_t match;
-				/* The match positions of a single-line regex. */
-			const linestruct *priorline = line->prev;
-				/* The line before the current one, if any. */
-			regmatch_t startmatch, endmatch;
-				/* The match positions of the start and end regexes. */
-
-			/* First case: varnish is a single-line expression. */
-			if (varnish->end == NULL) {
-				while (index < PAINT_LIMIT && index < till_x) {
-					/* If there is no match, go on to the next line. */
-					if (regexec(varnish->start, &line->data[index], 1,
-								&match, (index == 0) ? 0 : REG_NOTBOL) != 0)
-						break;
-
-					/* Translate the match to the beginning of the line. */
-					match.rm_so += index;
-					match.rm_eo += index;
-					index = match.rm_eo;
-
-					/* If the match is offscreen to the right, this rule is done. */
-					if (match.rm_so >= till_x)
-						break;
-
-					/* If the match has length zero, advance over it. */
-					if (match.rm_so == match.rm_eo) {
-						if (line->data[index] == '\0')
-							break;
-						index = step_right(line->data, index);
-						continue;
-					}
-
-					/* If the match is offscreen to the left, skip to next. */
-					if (match.rm_eo <= from_x)
-						continue;
-
-					if (match.rm_so > from_x)
-						start_col = wideness(line->data, match.rm_so) - from_col;
-
-					thetext = converted + actual_x(converted, start_col);
-
-					paintlen = actual_x(thetext, wideness(line->data,
-										match.rm_eo) - from_col - start_col);
-
-					wattron(midwin, varnish->attributes);
-					mvwaddnstr(midwin, row, margin + start_col, thetext, paintlen);
-					wattroff(midwin, varnish->attributes);
-				}
 
+			if (span->end <= from_x || span->start >= till_x)
 				continue;
-			}
-
-			/* Second case: varnish is a multiline expression. */
-
-			/* Assume nothing gets painted until proven otherwise below. */
-			line->multidata[varnish->id] = NOTHING;
 
-			if (priorline && !priorline->multidata)
-				statusline(ALERT, "Missing multidata -- please report a bug");
-			else
-
-			/* If there is an unterminated start match before the current line,
-			 * we need to look for an end match first. */
-			if (priorline && (priorline->multidata[varnish->id] == WHOLELINE ||
-								priorline->multidata[varnish->id] == STARTSHERE)) {
-				/* If there is no end on this line, paint whole line, and be done. */
-				if (regexec(varnish->end, line->data, 1, &endmatch, 0) == REG_NOMATCH) {
-					wattron(midwin, varnish->attributes);
-					mvwaddnstr(midwin, row, margin, converted, -1);
-					wattroff(midwin, varnish->attributes);
-					line->multidata[varnish->id] = WHOLELINE;
-					continue;
-				}
-
-				/* Only if it is visible, paint the part to be coloured. */
-				if (endmatch.rm_eo > from_x) {
-					paintlen = actual_x(converted, wideness(line->data,
-													endmatch.rm_eo) - from_col);
-					wattron(midwin, varnish->attributes);
-					mvwaddnstr(midwin, row, margin, converted, paintlen);
-					wattroff(midwin, varnish->attributes);
-				}
-
-				line->multidata[varnish->id] = ENDSHERE;
-				index = endmatch.rm_eo;
-			}
+			if (span->start > from_x)
+				start_col = wideness_in(line, span->start) - from_col;
 
-			/* Now look for start matches on this line. */
-			while (index < PAINT_LIMIT && regexec(varnish->start, line->data + index,
-								1, &startmatch, (index == 0) ? 0 : REG_NOTBOL) == 0) {
-				/* Make the match relative to the beginning of the line. */
-				startmatch.rm_so += index;
-				startmatch.rm_eo += index;
-
-				if (startmatch.rm_so > from_x)
-					start_col = wideness(line->data, startmatch.rm_so) - from_col;
-
-				thetext = converted + actual_x(converted, start_col);
-
-				if (regexec(varnish->end, line->data + startmatch.rm_eo, 1, &endmatch,
-									(startmatch.rm_eo == 0) ? 0 : REG_NOTBOL) == 0) {
-					/* Make the match relative to the beginning of the line. */
-					endmatch.rm_so += startmatch.rm_eo;
-					endmatch.rm_eo += startmatch.rm_eo;
-					/* Only paint the match if it is visible on screen
-					 * and it is more than zero characters long. */
-					if (endmatch.rm_eo > from_x && endmatch.rm_eo > startmatch.rm_so) {
-						paintlen = actual_x(thetext, wideness(line->data,
-											endmatch.rm_eo) - from_col - start_col);
-
-						wattron(midwin, varnish->attributes);
-						mvwaddnstr(midwin, row, margin + start_col, thetext, paintlen);
-						wattroff(midwin, varnish->attributes);
-
-						line->multidata[varnish->id] = JUSTONTHIS;
-					}
-					index = endmatch.rm_eo;
-					/* If both start and end match are anchors, advance. */
-					if (startmatch.rm_so == startmatch.rm_eo &&
-										endmatch.rm_so == endmatch.rm_eo) {
-						if (line->data[index] == '\0')
-							break;
-						index = step_right(line->data, index);
-					}
-					continue;
-				}
+			thetext = converted + actual_x(converted, start_col);
 
-				/* Paint the rest of the line, and we're done. */
-				wattron(midwin, varnish->attributes);
-				mvwaddnstr(midwin, row, margin + start_col, thetext, -1);
-				wattroff(midwin, varnish->attributes);
+			if (span->end != TO_THE_END)
+				paintlen = actual_x(thetext, wideness_in(line,
+										span->end) - from_col - start_col);
 
-				line->multidata[varnish->id] = STARTSHERE;
-				break;
-			}
+			wattron(midwin, span->attributes);
+			mvwaddnstr(midwin, row, margin + start_col, thetext, paintlen);
+			wattroff(midwin, span->attributes);
 		}
 	}
 #endif /* ENABLE_COLOR */
@@ -2776,10 +2950,10 @@ void draw_row(int row, const char *converted, linestruct *line, size_t from_col)
 	}
 
 	/* If the line is at least partially selected, paint the marked part. */
-	if (openfile->mark && ((line->lineno >= openfile->mark->lineno &&
-						line->lineno <= openfile->current->lineno) ||
-						(line->lineno <= openfile->mark->lineno &&
-						line->lineno >= openfile->current->lineno))) {
+	if (openfile->mark && ((lineno_of(line) >= lineno_of(openfile->mark) &&
+						lineno_of(line) <= lineno_of(openfile->current)) ||
+						(lineno_of(line) <= lineno_of(openfile->mark) &&
+						lineno_of(line) >= lineno_of(openfile->current)))) {
 		linestruct *top, *bot;
 			/* The lines where the marked region begins and ends. */
 		size_t top_x, bot_x;
@@ -2793,15 +2967,15 @@ void draw_row(int row, const char *converted, linestruct *line, size_t from_col)
 
 		get_region(&top, &top_x, &bot, &bot_x);
 
-		if (top->lineno < line->lineno || top_x < from_x)
+		if (lineno_of(top) < lineno_of(line) || top_x < from_x)
 			top_x = from_x;
-		if (bot->lineno > line->lineno || bot_x > till_x)
+		if (lineno_of(bot) > lineno_of(line) || bot_x > till_x)
 			bot_x = till_x;
 
 		/* Only paint if the marked part of the line is on this page. */
 		if (top_x < till_x && bot_x > from_x) {
 			/* Compute on which screen column to start painting. */
-			start_col = wideness(line->data, top_x) - from_col;
+			start_col = wideness_in(line, top_x) - from_col;
 
 			if (start_col < 0)
 				start_col = 0;
@@ -2811,7 +2985,7 @@ void draw_row(int row, const char *converted, linestruct *line, size_t from_col)
 			/* If the end of the mark is onscreen, compute how many
 			 * characters to paint.  Otherwise, just paint all. */
 			if (bot_x < till_x) {
-				size_t end_col = wideness(line->data, bot_x) - from_col;
+				size_t end_col = wideness_in(line, bot_x) - from_col;
 				paintlen = actual_x(thetext, end_col - start_col);
 			}
 
@@ -2845,11 +3019,11 @@ int update_line(linestruct *line, size_t index)
 		from_col = openfile->brink;
 	else
 #endif
-		from_col = get_page_start(wideness(line->data, index));
-	row = line->lineno - openfile->edittop->lineno;
+		from_col = get_page_start(wideness_in(line, index));
+	row = lineno_of(line) - lineno_of(openfile->edittop);
 
 	/* Expand the piece to be drawn to its representable form, and draw it. */
-	converted = display_string(line->data, from_col, editwincols, TRUE, FALSE);
+	converted = display_line(line, from_col, editwincols);
 	draw_row(row, converted, line, from_col);
 
 	if (from_col > 0 && *converted) {
@@ -2916,7 +3090,7 @@ int update_softwrapped_line(linestruct *line)
 		sequel_column = (end_of_line) ? 0 : to_col;
 
 		/* Convert the chunk to its displayable form and draw it. */
-		converted = display_string(line->data, from_col, to_col - from_col, TRUE, FALSE);
+		converted = display_line(line, from_col, to_col - from_col);
 		draw_row(row++, converted, line, from_col);
 		free(converted);
 
@@ -3038,31 +3212,31 @@ bool less_than_a_screenful(size_t was_lineno, size_t was_leftedge)
 		size_t leftedge = leftedge_for(xplustabs(), openfile->current);
 		int rows_left = go_back_chunks(editwinrows - 1, &line, &leftedge);
 
-		return (rows_left > 0 || line->lineno < was_lineno ||
-				(line->lineno == was_lineno && leftedge <= was_leftedge));
+		return (rows_left > 0 || lineno_of(line) < was_lineno ||
+				(lineno_of(line) == was_lineno && leftedge <= was_leftedge));
 	} else
 #endif
-		return (openfile->current->lineno - was_lineno < editwinrows);
+		return (lineno_of(openfile->current) - was_lineno < editwinrows);
 }
 
 #ifndef NANO_TINY
 /* Draw a "scroll bar" on the righthand side of the edit window. */
 void draw_scrollbar(void)
 {
-	int fromline = openfile->edittop->lineno - 1;
-	int totallines = openfile->filebot->lineno;
+	int fromline = lineno_of(openfile->edittop) - 1;
+	int totallines = lineno_of(openfile->filebot);
 	int coveredlines = editwinrows;
 
 	if (ISSET(SOFTWRAP)) {
 		linestruct *line = openfile->edittop;
 		int extras = extra_chunks_in(line) - chunk_for(openfile->firstcolumn, line);
 
-		while (line->lineno + extras < fromline + editwinrows && line->next) {
+		while (lineno_of(line) + extras < fromline + editwinrows && line->next) {
 			line = line->next;
 			extras += extra_chunks_in(line);
 		}
 
-		coveredlines = line->lineno - fromline;
+		coveredlines = lineno_of(line) - fromline;
 	}
 
 	int lowest = (fromline * editwinrows) / totallines;
@@ -3303,12 +3477,12 @@ bool current_is_above_screen(void)
 {
 #ifndef NANO_TINY
 	if (ISSET(SOFTWRAP))
-		return (openfile->current->lineno < openfile->edittop->lineno ||
-				(openfile->current->lineno == openfile->edittop->lineno &&
+		return (lineno_of(openfile->current) < lineno_of(openfile->edittop) ||
+				(lineno_of(openfile->current) == lineno_of(openfile->edittop) &&
 				xplustabs() < openfile->firstcolumn));
 	else
 #endif
-		return (openfile->current->lineno < openfile->edittop->lineno);
+		return (lineno_of(openfile->current) < lineno_of(openfile->edittop));
 }
 
 #define SHIM  (ISSET(ZERO) && (currmenu == MREPLACEWITH || currmenu == MYESNO) ? 1 : 0)
@@ -3324,13 +3498,13 @@ bool current_is_below_screen(void)
 		/* If current[current_x] is more than a screen's worth of lines after
 		 * edittop at column firstcolumn, it's below the screen. */
 		return (go_forward_chunks(editwinrows - 1 - SHIM, &line, &leftedge) == 0 &&
-						(line->lineno < openfile->current->lineno ||
-						(line->lineno == openfile->current->lineno &&
+						(lineno_of(line) < lineno_of(openfile->current) ||
+						(lineno_of(line) == lineno_of(openfile->current) &&
 						leftedge < leftedge_for(xplustabs(), openfile->current))));
 	} else
 #endif
-		return (openfile->current->lineno >=
-						openfile->edittop->lineno + editwinrows - SHIM);
+		return (lineno_of(openfile->current) >=
+						lineno_of(openfile->edittop) + editwinrows - SHIM);
 }
 
 /* Return TRUE if current[current_x] is outside the viewport. */
@@ -3367,7 +3541,7 @@ void edit_redraw(linestruct *old_current, update_type manner)
 		while (line != openfile->current) {
 			update_line(line, 0);
 
-			line = (line->lineno > openfile->current->lineno) ? line->prev : line->next;
+			line = (lineno_of(line) > lineno_of(openfile->current)) ? line->prev : line->next;
 		}
 	} else
 #endif
@@ -3406,7 +3580,8 @@ void edit_refresh(void)
 		prepare_palette();
 
 	/* When the line above the viewport does not have multidata, recalculate all. */
-	recook |= ISSET(SOFTWRAP) && openfile->edittop->prev && !openfile->edittop->prev->multidata;
+	recook |= ISSET(SOFTWRAP) && openfile->edittop->prev &&
+						!HAS_MULTIDATA(openfile->edittop->prev);
 
 	if (recook) {
 		precalc_multicolorinfo();
@@ -3509,7 +3684,7 @@ void draw_all_subwindows(void)
 /* Display on the status bar details about the current cursor position. */
 void report_cursor_position(void)
 {
-	size_t fullwidth = breadth(openfile->current->data) + 1;
+	size_t fullwidth = breadth_of(openfile->current) + 1;
 	size_t column = xplustabs() + 1;
 	int linepct, colpct, charpct;
 	char saved_byte;
@@ -3519,19 +3694,22 @@ void report_cursor_position(void)
 	openfile->current->data[openfile->current_x] = '\0';
 
 	/* Determine the size of the file up to the cursor. */
-	sum = number_of_characters_in(openfile->filetop, openfile->current);
+	sum = mbstrlen(openfile->current->data);
 
 	openfile->current->data[openfile->current_x] = saved_byte;
 
+	if (openfile->current != openfile->filetop)
+		sum += number_of_characters_in(openfile->filetop, openfile->current->prev) + 1;
+
 	/* Calculate the percentages. */
-	linepct = 100 * openfile->current->lineno / openfile->filebot->lineno;
+	linepct = 100 * lineno_of(openfile->current) / lineno_of(openfile->filebot);
 	colpct = 100 * column / fullwidth;
 	charpct = (openfile->totsize == 0) ? 0 : 100 * sum / openfile->totsize;
 
 	statusline(INFO,
 			_("line %*zd/%zd (%2d%%), col %2zu/%2zu (%3d%%), char %*zu/%zu (%2d%%)"),
-			digits(openfile->filebot->lineno),
-			openfile->current->lineno, openfile->filebot->lineno, linepct,
+			digits(lineno_of(openfile->filebot)),
+			lineno_of(openfile->current), lineno_of(openfile->filebot), linepct,
 			column, fullwidth, colpct,
 			digits(openfile->totsize), sum, openfile->totsize, charpct);
 }